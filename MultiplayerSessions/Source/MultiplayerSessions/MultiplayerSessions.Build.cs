@@ -26,11 +26,10 @@ public class MultiplayerSessions : ModuleRules
 			new string[]
 			{
 				"Core",
+				"CoreUObject",
+				"Engine",
 				"OnlineSubsystem",
-				"OnlineSubsystemSteam",
-				"UMG",
-				"Slate",
-				"SlateCore"
+				"OnlineSubsystemSteam"
 				// ... add other public dependencies that you statically link with here ...
 			}
 			);
@@ -39,10 +38,11 @@ public class MultiplayerSessions : ModuleRules
 		PrivateDependencyModuleNames.AddRange(
 			new string[]
 			{
-				"CoreUObject",
-				"Engine",
-				"Slate",
-				"SlateCore",
+				"TraceLog",
+				"Json",
+				"OnlineSubsystemUtils",
+				"Sockets",
+				"Networking",
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
@@ -0,0 +1,395 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LanSessionDiscovery.h"
+#include "MultiplayerSessions.h"
+#include "MultiplayerSessionsTrace.h"
+#include "SessionAttributes.h"
+#include "OnlineSubsystemTypes.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+#include "IPAddress.h"
+#include "Common/UdpSocketBuilder.h"
+#include "Interfaces/IPv4/IPv4Endpoint.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "Misc/Guid.h"
+
+/*
+* Packet layout, all little endian
+* Header: uint32 Magic, uint8 Version, uint8 PacketType
+* Query:  uint32 Nonce, uint32 SentAtMs, int32 BuildUniqueId, int32 MatchType
+* Advert: uint32 Nonce, uint32 SentAtMs (echoed from the query), uint64 HostId, int32 BuildUniqueId,
+*         uint16 GamePort, uint8 OpenSlots, uint8 MaxSlots, int32 MatchType, string OwningUserName
+* MatchType is the packed value of FSessionAttributes, 0 in a query finds every match type
+* Strings are a uint8 byte count followed by that many UTF-8 bytes
+* Bump the version whenever the layout changes, packets of other versions are dropped
+*/
+static constexpr uint32 LanPacketMagic = 0x444C534D;
+static constexpr uint8 LanPacketVersion = 2;
+static constexpr int32 MaxLanPacketBytes = 1024;
+
+enum class ELanPacketType : uint8
+{
+	Query = 1,
+	Advert = 2
+};
+
+static const FName LanDiscoveryNetIdType(TEXT("LanDiscovery"));
+
+static void WriteShortString(FArchive& archive, const FString& value)
+{
+	FTCHARToUTF8 utf8(*value);
+	uint8 numBytes = (uint8)FMath::Min(utf8.Length(), 255);
+	archive << numBytes;
+	archive.Serialize((void*)utf8.Get(), numBytes);
+}
+
+static bool ReadShortString(FArchive& archive, FString& outValue)
+{
+	uint8 numBytes = 0;
+	archive << numBytes;
+
+	ANSICHAR bytes[256];
+	archive.Serialize(bytes, numBytes);
+	if (archive.IsError())
+	{
+		return false;
+	}
+
+	FUTF8ToTCHAR converted(bytes, numBytes);
+	outValue = FString(converted.Length(), converted.Get());
+	return true;
+}
+
+static void WriteHeader(FArchive& archive, ELanPacketType packetType)
+{
+	uint32 magic = LanPacketMagic;
+	uint8 version = LanPacketVersion;
+	uint8 type = (uint8)packetType;
+	archive << magic << version << type;
+}
+
+static bool ReadHeader(FArchive& archive, ELanPacketType expectedType)
+{
+	uint32 magic = 0;
+	uint8 version = 0;
+	uint8 type = 0;
+	archive << magic << version << type;
+	return !archive.IsError() && magic == LanPacketMagic && version == LanPacketVersion && type == (uint8)expectedType;
+}
+
+FOnlineSessionInfoLanDiscovery::FOnlineSessionInfoLanDiscovery(const FString& sessionId, const FString& hostAddress):
+	SessionId(FUniqueNetIdString::Create(sessionId, LanDiscoveryNetIdType)),
+	HostAddress(hostAddress)
+{
+}
+
+FLanSessionDiscovery::FLanSessionDiscovery(const FString& multicastGroup, int32 port):
+	Port(port)
+{
+	ReceiveBuffer.SetNumUninitialized(MaxLanPacketBytes);
+
+	FIPv4Address groupIp;
+	if (!FIPv4Address::Parse(multicastGroup, groupIp) || !groupIp.IsMulticastAddress())
+	{
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("LAN discovery group %s is not a multicast address"), *multicastGroup);
+		return;
+	}
+
+	GroupAddress = FIPv4Endpoint(groupIp, (uint16)port).ToInternetAddr();
+}
+
+FLanSessionDiscovery::~FLanSessionDiscovery()
+{
+	StopAdvertising();
+	StopQuery();
+}
+
+bool FLanSessionDiscovery::StartAdvertising(FOnFillAdvert&& onFillAdvert)
+{
+	StopAdvertising();
+
+	AdvertSocket = CreateSocket(TEXT("LanSessionDiscoveryAdvert"), true);
+	if (!AdvertSocket)
+	{
+		return false;
+	}
+
+	OnFillAdvert = MoveTemp(onFillAdvert);
+	const FGuid hostGuid = FGuid::NewGuid();
+	HostId = ((uint64)hostGuid.A << 32) | hostGuid.B;
+	AdvertTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FLanSessionDiscovery::TickAdvertising));
+	return true;
+}
+
+void FLanSessionDiscovery::StopAdvertising()
+{
+	if (AdvertTickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(AdvertTickerHandle);
+		AdvertTickerHandle.Reset();
+	}
+
+	DestroySocket(AdvertSocket);
+	OnFillAdvert.Unbind();
+}
+
+bool FLanSessionDiscovery::TickAdvertising(float deltaTime)
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(FLanSessionDiscovery::TickAdvertising);
+
+	ISocketSubsystem* pSockets = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	TSharedRef<FInternetAddr> senderAddress = pSockets->CreateInternetAddr();
+
+	int32 bytesRead = 0;
+	while (AdvertSocket && AdvertSocket->RecvFrom(ReceiveBuffer.GetData(), ReceiveBuffer.Num(), bytesRead, *senderAddress) && bytesRead > 0)
+	{
+		FMemoryReader reader(TArrayView<const uint8>(ReceiveBuffer.GetData(), bytesRead));
+		if (!ReadHeader(reader, ELanPacketType::Query))
+		{
+			continue;
+		}
+
+		uint32 nonce = 0;
+		uint32 sentAtMs = 0;
+		int32 buildUniqueId = 0;
+		int32 matchType = 0;
+		reader << nonce << sentAtMs << buildUniqueId << matchType;
+		if (reader.IsError())
+		{
+			continue;
+		}
+
+		FLanSessionAdvert advert;
+		if (!OnFillAdvert.IsBound() || !OnFillAdvert.Execute(advert))
+		{
+			continue;
+		}
+
+		//Hosts the client can't join or doesn't want stay quiet, that keeps busy networks quiet too
+		if (buildUniqueId != advert.BuildUniqueId || (matchType != 0 && matchType != advert.MatchType))
+		{
+			continue;
+		}
+
+		TArray<uint8> packet;
+		FMemoryWriter writer(packet);
+		WriteHeader(writer, ELanPacketType::Advert);
+		uint16 gamePort = (uint16)advert.GamePort;
+		uint8 openSlots = (uint8)FMath::Clamp(advert.OpenSlots, 0, 255);
+		uint8 maxSlots = (uint8)FMath::Clamp(advert.MaxSlots, 0, 255);
+		writer << nonce << sentAtMs << HostId << advert.BuildUniqueId << gamePort << openSlots << maxSlots << advert.MatchType;
+		WriteShortString(writer, advert.OwningUserName);
+
+		//Answer the client directly, only the query goes to the group
+		int32 bytesSent = 0;
+		AdvertSocket->SendTo(packet.GetData(), packet.Num(), bytesSent, *senderAddress);
+	}
+
+	return true;
+}
+
+bool FLanSessionDiscovery::StartQuery(const FLanSessionDiscoveryQuery& query, FOnHostFound&& onHostFound, FOnDiscoveryComplete&& onComplete)
+{
+	StopQuery();
+
+	QuerySocket = CreateSocket(TEXT("LanSessionDiscoveryQuery"), false);
+	if (!QuerySocket)
+	{
+		return false;
+	}
+
+	Query = query;
+	OnHostFound = MoveTemp(onHostFound);
+	OnComplete = MoveTemp(onComplete);
+	++QueryNonce;
+	RepliedHostIds.Reset();
+	QueryStartTime = FPlatformTime::Seconds();
+	LastReplyTime = 0.0;
+
+	SendQuery();
+	QueryTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FLanSessionDiscovery::TickQuery));
+	return true;
+}
+
+void FLanSessionDiscovery::StopQuery()
+{
+	if (QueryTickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(QueryTickerHandle);
+		QueryTickerHandle.Reset();
+	}
+
+	DestroySocket(QuerySocket);
+	OnHostFound.Unbind();
+	OnComplete.Unbind();
+}
+
+void FLanSessionDiscovery::SendQuery()
+{
+	LastQuerySendTime = FPlatformTime::Seconds();
+
+	TArray<uint8> packet;
+	FMemoryWriter writer(packet);
+	WriteHeader(writer, ELanPacketType::Query);
+	uint32 sentAtMs = (uint32)((LastQuerySendTime - QueryStartTime) * 1000.0);
+	writer << QueryNonce << sentAtMs << Query.BuildUniqueId << Query.MatchType;
+
+	int32 bytesSent = 0;
+	QuerySocket->SendTo(packet.GetData(), packet.Num(), bytesSent, *GroupAddress);
+}
+
+bool FLanSessionDiscovery::TickQuery(float deltaTime)
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(FLanSessionDiscovery::TickQuery);
+
+	ISocketSubsystem* pSockets = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	TSharedRef<FInternetAddr> senderAddress = pSockets->CreateInternetAddr();
+
+	int32 bytesRead = 0;
+	while (QuerySocket && QuerySocket->RecvFrom(ReceiveBuffer.GetData(), ReceiveBuffer.Num(), bytesRead, *senderAddress) && bytesRead > 0)
+	{
+		FMemoryReader reader(TArrayView<const uint8>(ReceiveBuffer.GetData(), bytesRead));
+		if (!ReadHeader(reader, ELanPacketType::Advert))
+		{
+			continue;
+		}
+
+		uint32 nonce = 0;
+		uint32 sentAtMs = 0;
+		uint64 hostId = 0;
+		int32 buildUniqueId = 0;
+		uint16 gamePort = 0;
+		uint8 openSlots = 0;
+		uint8 maxSlots = 0;
+		int32 matchType = 0;
+		FString owningUserName;
+		reader << nonce << sentAtMs << hostId << buildUniqueId << gamePort << openSlots << maxSlots << matchType;
+		if (!ReadShortString(reader, owningUserName))
+		{
+			continue;
+		}
+
+		//Late replies to an older query, or a host that already answered one of the resends
+		if (nonce != QueryNonce || RepliedHostIds.Contains(hostId))
+		{
+			continue;
+		}
+		RepliedHostIds.Add(hostId);
+
+		const double now = FPlatformTime::Seconds();
+		LastReplyTime = now;
+
+		senderAddress->SetPort(gamePort);
+
+		FOnlineSessionSearchResult result;
+		result.PingInMs = FMath::Max(0, FMath::RoundToInt((now - QueryStartTime) * 1000.0) - (int32)sentAtMs);
+		FOnlineSession& session = result.Session;
+		session.OwningUserName = owningUserName;
+		session.NumOpenPublicConnections = openSlots;
+		session.SessionInfo = MakeShared<FOnlineSessionInfoLanDiscovery>(FString::Printf(TEXT("%016llx"), hostId), senderAddress->ToString(true));
+		session.SessionSettings.bIsLANMatch = true;
+		session.SessionSettings.bShouldAdvertise = true;
+		session.SessionSettings.bAllowJoinInProgress = true;
+		session.SessionSettings.NumPublicConnections = maxSlots;
+		session.SessionSettings.BuildUniqueId = buildUniqueId;
+		FSessionAttributes::Unpack(matchType).WriteTo(session.SessionSettings);
+
+		OnHostFound.ExecuteIfBound(result);
+		if (!QuerySocket)
+		{
+			//Stopped from inside the callback
+			return false;
+		}
+	}
+
+	const double now = FPlatformTime::Seconds();
+	if (RepliedHostIds.Num() >= Query.MaxResults)
+	{
+		CompleteQuery(true);
+		return false;
+	}
+
+	//Everyone on the LAN answers within a few milliseconds, a quiet wire means we heard them all
+	const bool bQuiet = Query.QuietSeconds > 0.0f && LastReplyTime > 0.0 && now - LastReplyTime >= Query.QuietSeconds;
+	if (bQuiet || now - QueryStartTime >= Query.TimeoutSeconds)
+	{
+		CompleteQuery(true);
+		return false;
+	}
+
+	if (now - LastQuerySendTime >= Query.ResendIntervalSeconds)
+	{
+		SendQuery();
+	}
+	return true;
+}
+
+void FLanSessionDiscovery::CompleteQuery(bool bWasSuccessful)
+{
+	//The ticker removes itself by returning false
+	QueryTickerHandle.Reset();
+	DestroySocket(QuerySocket);
+
+	FOnDiscoveryComplete onComplete = MoveTemp(OnComplete);
+	OnComplete.Unbind();
+	OnHostFound.Unbind();
+	onComplete.ExecuteIfBound(bWasSuccessful);
+}
+
+FSocket* FLanSessionDiscovery::CreateSocket(const TCHAR* description, bool bJoinGroup) const
+{
+	if (!GroupAddress.IsValid())
+	{
+		return nullptr;
+	}
+
+	//Several hosts on one machine share the port, loopback lets clients on that machine hear them
+	FUdpSocketBuilder builder(description);
+	builder.AsNonBlocking()
+		.AsReusable()
+		.WithMulticastLoopback()
+		.WithMulticastTtl(1)
+		.WithReceiveBufferSize(64 * 1024);
+
+	if (bJoinGroup)
+	{
+		builder.BoundToPort(Port).JoinedToGroup(FIPv4Endpoint(GroupAddress).Address);
+	}
+	else
+	{
+		builder.BoundToPort(0);
+	}
+
+	FSocket* pSocket = builder.Build();
+	if (!pSocket)
+	{
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("Failed to create LAN discovery socket %s on port %d"), description, bJoinGroup ? Port : 0);
+	}
+	return pSocket;
+}
+
+void FLanSessionDiscovery::DestroySocket(FSocket*& pSocket) const
+{
+	if (!pSocket)
+	{
+		return;
+	}
+
+	pSocket->Close();
+	ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(pSocket);
+	pSocket = nullptr;
+}
+
+bool FLanSessionDiscovery::GetHostAddress(const FOnlineSessionSearchResult& result, FString& outHostAddress)
+{
+	const TSharedPtr<FOnlineSessionInfo>& pSessionInfo = result.Session.SessionInfo;
+	if (!pSessionInfo.IsValid() || pSessionInfo->GetSessionId().GetType() != LanDiscoveryNetIdType)
+	{
+		return false;
+	}
+
+	outHostAddress = StaticCastSharedPtr<FOnlineSessionInfoLanDiscovery>(pSessionInfo)->GetHostAddress();
+	return true;
+}
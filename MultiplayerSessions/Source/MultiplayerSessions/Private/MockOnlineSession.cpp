@@ -0,0 +1,753 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MockOnlineSession.h"
+#include "MultiplayerSessions.h"
+#include "SessionSearchQuery.h"
+#include "SessionAttributes.h"
+#include "Containers/Ticker.h"
+#include "Misc/Parse.h"
+#include "OnlineSubsystemTypes.h"
+
+static const FName MockNetIdType(TEXT("Mock"));
+static const FString MockHostAddress(TEXT("127.0.0.1:7777"));
+
+FMockOnlineSessionConfig FMockOnlineSessionConfig::FromCommandLine(const TCHAR* commandLine)
+{
+	FMockOnlineSessionConfig config;
+
+	FParse::Value(commandLine, TEXT("MockLatency="), config.LatencySeconds);
+	FParse::Value(commandLine, TEXT("MockJitter="), config.LatencyJitterSeconds);
+	FParse::Value(commandLine, TEXT("MockFailureRate="), config.FailureRate);
+	FParse::Value(commandLine, TEXT("MockResults="), config.NumSearchResults);
+	FParse::Value(commandLine, TEXT("MockResultsPerTick="), config.ResultsPerTick);
+	FParse::Value(commandLine, TEXT("MockPayload="), config.PayloadBytes);
+	FParse::Value(commandLine, TEXT("MockSeed="), config.RandomSeed);
+
+	FString matchTypes;
+	if (FParse::Value(commandLine, TEXT("MockMatchTypes="), matchTypes, false))
+	{
+		config.MatchTypes.Reset();
+		matchTypes.ParseIntoArray(config.MatchTypes, TEXT(","));
+	}
+
+	return config;
+}
+
+FOnlineSessionInfoMock::FOnlineSessionInfoMock(const FString& sessionId, const FString& hostAddress):
+	SessionId(FUniqueNetIdString::Create(sessionId, MockNetIdType)),
+	HostAddress(hostAddress)
+{
+}
+
+//Id the session info of a session carries, used to look it up in the backend
+static FString GetSessionIdString(const FOnlineSession& session)
+{
+	return session.SessionInfo.IsValid() ? session.SessionInfo->GetSessionId().ToString() : FString();
+}
+
+FString FMockSessionBackend::MakeSessionId()
+{
+	return FString::Printf(TEXT("MockHostedSession_%d"), NextSessionId++);
+}
+
+void FMockSessionBackend::AddHostedSession(const FString& sessionId, const FOnlineSession& session)
+{
+	HostedSessions.Add(sessionId, session);
+}
+
+void FMockSessionBackend::RemoveHostedSession(const FString& sessionId)
+{
+	HostedSessions.Remove(sessionId);
+}
+
+void FMockSessionBackend::GetSearchResults(TArray<FOnlineSessionSearchResult>& outSearchResults) const
+{
+	outSearchResults.Reserve(outSearchResults.Num() + HostedSessions.Num());
+	for (const TPair<FString, FOnlineSession>& hostedSession : HostedSessions)
+	{
+		FOnlineSessionSearchResult& result = outSearchResults.AddDefaulted_GetRef();
+		result.Session = hostedSession.Value;
+	}
+}
+
+EOnJoinSessionCompleteResult::Type FMockSessionBackend::ReserveSlot(const FString& sessionId)
+{
+	FOnlineSession* pSession = HostedSessions.Find(sessionId);
+	if (!pSession)
+	{
+		return EOnJoinSessionCompleteResult::SessionDoesNotExist;
+	}
+
+	if (pSession->NumOpenPublicConnections <= 0)
+	{
+		return EOnJoinSessionCompleteResult::SessionIsFull;
+	}
+
+	--pSession->NumOpenPublicConnections;
+	return EOnJoinSessionCompleteResult::Success;
+}
+
+void FMockSessionBackend::ReleaseSlot(const FString& sessionId)
+{
+	FOnlineSession* pSession = HostedSessions.Find(sessionId);
+	if (pSession)
+	{
+		pSession->NumOpenPublicConnections = FMath::Min(pSession->NumOpenPublicConnections + 1, pSession->SessionSettings.NumPublicConnections);
+	}
+}
+
+FMockOnlineSession::FMockOnlineSession(const FMockOnlineSessionConfig& config):
+	Config(config),
+	RandomStream(config.RandomSeed),
+	HostUserId(FUniqueNetIdString::Create(FString::Printf(TEXT("MockHost_%d"), config.RandomSeed), MockNetIdType))
+{
+}
+
+FMockOnlineSession::~FMockOnlineSession()
+{
+}
+
+void FMockOnlineSession::SetConfig(const FMockOnlineSessionConfig& config)
+{
+	Config = config;
+	RandomStream.Initialize(config.RandomSeed);
+}
+
+FOnlineSessionSearchResult FMockOnlineSession::MakeSearchResult(int32 index) const
+{
+	//Every result gets its own stream, so result N is identical no matter how many results were requested
+	FRandomStream resultStream(Config.RandomSeed + index);
+
+	FOnlineSessionSearchResult result;
+	result.PingInMs = resultStream.RandRange(Config.MinPingInMs, Config.MaxPingInMs);
+
+	FOnlineSession& session = result.Session;
+	session.OwningUserId = FUniqueNetIdString::Create(FString::Printf(TEXT("MockUser_%d"), index), MockNetIdType);
+	session.OwningUserName = FString::Printf(TEXT("MockHost %d"), index);
+	session.SessionInfo = MakeShared<FOnlineSessionInfoMock>(FString::Printf(TEXT("MockSession_%d"), index), MockHostAddress);
+	session.NumOpenPublicConnections = resultStream.RandRange(0, Config.MaxPublicConnections);
+
+	FOnlineSessionSettings& settings = session.SessionSettings;
+	settings.NumPublicConnections = Config.MaxPublicConnections;
+	settings.bShouldAdvertise = true;
+	settings.bUsesPresence = true;
+	settings.bAllowJoinInProgress = true;
+	settings.bAllowJoinViaPresence = true;
+	settings.bUseLobbiesIfAvailable = true;
+	settings.BuildUniqueId = FSessionAttributes::BuildUniqueId;
+
+	if (Config.MatchTypes.Num() > 0)
+	{
+		//Match types that are not in the table are left out, like a host would fail to create them
+		const FString& matchType = Config.MatchTypes[resultStream.RandRange(0, Config.MatchTypes.Num() - 1)];
+		FSessionAttributes attributes;
+		if (FSessionAttributes::Make(matchType, attributes))
+		{
+			attributes.WriteTo(settings);
+		}
+	}
+
+	if (Config.PayloadBytes > 0)
+	{
+		settings.Set(FName("Payload"), FString::ChrN(Config.PayloadBytes, TEXT('x')), EOnlineDataAdvertisementType::ViaOnlineService);
+	}
+
+	return result;
+}
+
+void FMockOnlineSession::CompleteAfterLatency(TFunction<void()>&& function)
+{
+	float delay = Config.LatencySeconds;
+	if (Config.LatencyJitterSeconds > 0.0f)
+	{
+		delay += RandomStream.FRandRange(0.0f, Config.LatencyJitterSeconds);
+	}
+
+	//The ticker runs on the game thread, like the callbacks of a real online subsystem
+	TWeakPtr<FMockOnlineSession, ESPMode::ThreadSafe> weakThis = AsShared();
+	FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([weakThis, function = MoveTemp(function)](float)
+	{
+		if (weakThis.IsValid())
+		{
+			function();
+		}
+		return false;
+	}), FMath::Max(delay, 0.0f));
+}
+
+bool FMockOnlineSession::RollFailure()
+{
+	return Config.FailureRate > 0.0f && RandomStream.FRand() < Config.FailureRate;
+}
+
+FUniqueNetIdPtr FMockOnlineSession::CreateSessionIdFromString(const FString& sessionIdStr)
+{
+	return FUniqueNetIdString::Create(sessionIdStr, MockNetIdType);
+}
+
+FNamedOnlineSession* FMockOnlineSession::GetNamedSession(FName sessionName)
+{
+	for (const TSharedRef<FNamedOnlineSession>& session : Sessions)
+	{
+		if (session->SessionName == sessionName)
+		{
+			return &session.Get();
+		}
+	}
+
+	return nullptr;
+}
+
+void FMockOnlineSession::RemoveNamedSession(FName sessionName)
+{
+	Sessions.RemoveAll([sessionName](const TSharedRef<FNamedOnlineSession>& session)
+	{
+		return session->SessionName == sessionName;
+	});
+}
+
+EOnlineSessionState::Type FMockOnlineSession::GetSessionState(FName sessionName) const
+{
+	for (const TSharedRef<FNamedOnlineSession>& session : Sessions)
+	{
+		if (session->SessionName == sessionName)
+		{
+			return session->SessionState;
+		}
+	}
+
+	return EOnlineSessionState::NoSession;
+}
+
+bool FMockOnlineSession::HasPresenceSession()
+{
+	return Sessions.ContainsByPredicate([](const TSharedRef<FNamedOnlineSession>& session)
+	{
+		return session->SessionSettings.bUsesPresence;
+	});
+}
+
+FNamedOnlineSession* FMockOnlineSession::AddNamedSession(FName sessionName, const FOnlineSessionSettings& sessionSettings)
+{
+	return &Sessions.Add_GetRef(MakeShared<FNamedOnlineSession>(sessionName, sessionSettings)).Get();
+}
+
+FNamedOnlineSession* FMockOnlineSession::AddNamedSession(FName sessionName, const FOnlineSession& session)
+{
+	return &Sessions.Add_GetRef(MakeShared<FNamedOnlineSession>(sessionName, session)).Get();
+}
+
+bool FMockOnlineSession::CreateSession(int32 hostingPlayerNum, FName sessionName, const FOnlineSessionSettings& newSessionSettings)
+{
+	return CreateSession(*HostUserId, sessionName, newSessionSettings);
+}
+
+bool FMockOnlineSession::CreateSession(const FUniqueNetId& hostingPlayerId, FName sessionName, const FOnlineSessionSettings& newSessionSettings)
+{
+	if (GetNamedSession(sessionName))
+	{
+		//Same as the real interfaces, a session name can only be used once
+		return false;
+	}
+
+	FNamedOnlineSession* pSession = AddNamedSession(sessionName, newSessionSettings);
+	pSession->SessionState = EOnlineSessionState::Creating;
+	pSession->bHosting = true;
+	pSession->OwningUserId = hostingPlayerId.AsShared();
+	pSession->LocalOwnerId = hostingPlayerId.AsShared();
+	pSession->NumOpenPublicConnections = newSessionSettings.NumPublicConnections;
+	pSession->NumOpenPrivateConnections = newSessionSettings.NumPrivateConnections;
+	const FString sessionId = Backend.IsValid() ? Backend->MakeSessionId() : FString::Printf(TEXT("MockHostedSession_%d"), NextSessionId++);
+	pSession->SessionInfo = MakeShared<FOnlineSessionInfoMock>(sessionId, MockHostAddress);
+
+	const bool bFailed = RollFailure();
+	CompleteAfterLatency([this, sessionName, sessionId, bFailed]()
+	{
+		if (bFailed)
+		{
+			RemoveNamedSession(sessionName);
+		}
+		else if (FNamedOnlineSession* pCreatedSession = GetNamedSession(sessionName))
+		{
+			pCreatedSession->SessionState = EOnlineSessionState::Pending;
+
+			//Other interfaces on the backend can find it from now on
+			if (Backend.IsValid() && pCreatedSession->SessionSettings.bShouldAdvertise)
+			{
+				Backend->AddHostedSession(sessionId, *pCreatedSession);
+			}
+		}
+
+		TriggerOnCreateSessionCompleteDelegates(sessionName, !bFailed);
+	});
+
+	return true;
+}
+
+bool FMockOnlineSession::StartSession(FName sessionName)
+{
+	FNamedOnlineSession* pSession = GetNamedSession(sessionName);
+	if (!pSession || (pSession->SessionState != EOnlineSessionState::Pending && pSession->SessionState != EOnlineSessionState::Ended))
+	{
+		return false;
+	}
+
+	pSession->SessionState = EOnlineSessionState::Starting;
+
+	const bool bFailed = RollFailure();
+	CompleteAfterLatency([this, sessionName, bFailed]()
+	{
+		if (FNamedOnlineSession* pStartedSession = GetNamedSession(sessionName))
+		{
+			pStartedSession->SessionState = bFailed ? EOnlineSessionState::Pending : EOnlineSessionState::InProgress;
+		}
+
+		TriggerOnStartSessionCompleteDelegates(sessionName, !bFailed);
+	});
+
+	return true;
+}
+
+bool FMockOnlineSession::UpdateSession(FName sessionName, FOnlineSessionSettings& updatedSessionSettings, bool bShouldRefreshOnlineData)
+{
+	FNamedOnlineSession* pSession = GetNamedSession(sessionName);
+	if (!pSession)
+	{
+		return false;
+	}
+
+	pSession->SessionSettings = updatedSessionSettings;
+
+	CompleteAfterLatency([this, sessionName]()
+	{
+		TriggerOnUpdateSessionCompleteDelegates(sessionName, true);
+	});
+
+	return true;
+}
+
+bool FMockOnlineSession::EndSession(FName sessionName)
+{
+	FNamedOnlineSession* pSession = GetNamedSession(sessionName);
+	if (!pSession || pSession->SessionState != EOnlineSessionState::InProgress)
+	{
+		return false;
+	}
+
+	pSession->SessionState = EOnlineSessionState::Ending;
+
+	CompleteAfterLatency([this, sessionName]()
+	{
+		if (FNamedOnlineSession* pEndedSession = GetNamedSession(sessionName))
+		{
+			pEndedSession->SessionState = EOnlineSessionState::Ended;
+		}
+
+		TriggerOnEndSessionCompleteDelegates(sessionName, true);
+	});
+
+	return true;
+}
+
+bool FMockOnlineSession::DestroySession(FName sessionName, const FOnDestroySessionCompleteDelegate& completionDelegate)
+{
+	FNamedOnlineSession* pSession = GetNamedSession(sessionName);
+	if (!pSession)
+	{
+		return false;
+	}
+
+	pSession->SessionState = EOnlineSessionState::Destroying;
+
+	const FString sessionId = GetSessionIdString(*pSession);
+	const bool bHosting = pSession->bHosting;
+	CompleteAfterLatency([this, sessionName, completionDelegate, sessionId, bHosting]()
+	{
+		RemoveNamedSession(sessionName);
+
+		//Hosts take their session off the backend, clients leaving give their slot back
+		if (Backend.IsValid())
+		{
+			if (bHosting)
+			{
+				Backend->RemoveHostedSession(sessionId);
+			}
+			else
+			{
+				Backend->ReleaseSlot(sessionId);
+			}
+		}
+
+		completionDelegate.ExecuteIfBound(sessionName, true);
+		TriggerOnDestroySessionCompleteDelegates(sessionName, true);
+	});
+
+	return true;
+}
+
+bool FMockOnlineSession::IsPlayerInSession(FName sessionName, const FUniqueNetId& uniqueId)
+{
+	FNamedOnlineSession* pSession = GetNamedSession(sessionName);
+	if (!pSession)
+	{
+		return false;
+	}
+
+	return pSession->RegisteredPlayers.ContainsByPredicate([&uniqueId](const FUniqueNetIdRef& playerId)
+	{
+		return *playerId == uniqueId;
+	});
+}
+
+bool FMockOnlineSession::StartMatchmaking(const TArray<FUniqueNetIdRef>& localPlayers, FName sessionName, const FOnlineSessionSettings& newSessionSettings, TSharedRef<FOnlineSessionSearch>& searchSettings)
+{
+	//Matchmaking is not simulated
+	return false;
+}
+
+bool FMockOnlineSession::CancelMatchmaking(int32 searchingPlayerNum, FName sessionName)
+{
+	return false;
+}
+
+bool FMockOnlineSession::CancelMatchmaking(const FUniqueNetId& searchingPlayerId, FName sessionName)
+{
+	return false;
+}
+
+bool FMockOnlineSession::FindSessions(int32 searchingPlayerNum, const TSharedRef<FOnlineSessionSearch>& searchSettings)
+{
+	return FindSessions(*HostUserId, searchSettings);
+}
+
+bool FMockOnlineSession::FindSessions(const FUniqueNetId& searchingPlayerId, const TSharedRef<FOnlineSessionSearch>& searchSettings)
+{
+	if (CurrentSessionSearch.IsValid() && CurrentSessionSearch->SearchState == EOnlineAsyncTaskState::InProgress)
+	{
+		//Only one search at a time, same as the real interfaces
+		return false;
+	}
+
+	CurrentSessionSearch = searchSettings;
+	CurrentSessionSearch->SearchResults.Empty();
+	CurrentSessionSearch->SearchState = EOnlineAsyncTaskState::InProgress;
+
+	const int32 generation = ++SearchGeneration;
+	const bool bFailed = RollFailure();
+	CompleteAfterLatency([this, generation, bFailed]()
+	{
+		if (generation != SearchGeneration || !CurrentSessionSearch.IsValid())
+		{
+			//Search got cancelled or replaced
+			return;
+		}
+
+		if (bFailed)
+		{
+			CurrentSessionSearch->SearchState = EOnlineAsyncTaskState::Failed;
+			TriggerOnFindSessionsCompleteDelegates(false);
+			return;
+		}
+
+		NextSearchResultIndex = 0;
+		CurrentSessionSearch->SearchResults.Reserve(FMath::Min(Config.NumSearchResults, CurrentSessionSearch->MaxSearchResults));
+
+		if (Backend.IsValid())
+		{
+			AddHostedSearchResults();
+		}
+		if (!DeliverSearchResults())
+		{
+			return;
+		}
+
+		//Hand out the rest over the next ticks, like beacon replies coming in one by one
+		TWeakPtr<FMockOnlineSession, ESPMode::ThreadSafe> weakThis = AsShared();
+		FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([weakThis, generation](float)
+		{
+			TSharedPtr<FMockOnlineSession, ESPMode::ThreadSafe> pThis = weakThis.Pin();
+			if (!pThis.IsValid() || generation != pThis->SearchGeneration || !pThis->CurrentSessionSearch.IsValid())
+			{
+				return false;
+			}
+
+			return pThis->DeliverSearchResults();
+		}));
+	});
+
+	return true;
+}
+
+void FMockOnlineSession::AddHostedSearchResults()
+{
+	TArray<FOnlineSessionSearchResult> hostedResults;
+	Backend->GetSearchResults(hostedResults);
+
+	TArray<FOnlineSessionSearchResult>& searchResults = CurrentSessionSearch->SearchResults;
+	for (FOnlineSessionSearchResult& result : hostedResults)
+	{
+		if (searchResults.Num() >= CurrentSessionSearch->MaxSearchResults)
+		{
+			break;
+		}
+
+		if (FSessionSearchQuery::MatchesSearchSettings(CurrentSessionSearch->QuerySettings, result))
+		{
+			result.PingInMs = RandomStream.RandRange(Config.MinPingInMs, Config.MaxPingInMs);
+			searchResults.Add(MoveTemp(result));
+		}
+	}
+}
+
+bool FMockOnlineSession::DeliverSearchResults()
+{
+	TArray<FOnlineSessionSearchResult>& searchResults = CurrentSessionSearch->SearchResults;
+	const int32 maxSearchResults = CurrentSessionSearch->MaxSearchResults;
+
+	//The fake backend holds NumSearchResults sessions, scan ResultsPerTick of them per tick
+	const int32 batchEnd = Config.ResultsPerTick > 0 ? FMath::Min(NextSearchResultIndex + Config.ResultsPerTick, Config.NumSearchResults) : Config.NumSearchResults;
+	for (; NextSearchResultIndex < batchEnd && searchResults.Num() < maxSearchResults; ++NextSearchResultIndex)
+	{
+		FOnlineSessionSearchResult result = MakeSearchResult(NextSearchResultIndex);
+
+		//Filter like a real backend, before the result gets sent
+		if (FSessionSearchQuery::MatchesSearchSettings(CurrentSessionSearch->QuerySettings, result))
+		{
+			searchResults.Add(MoveTemp(result));
+		}
+	}
+
+	if (NextSearchResultIndex < Config.NumSearchResults && searchResults.Num() < maxSearchResults)
+	{
+		return true;
+	}
+
+	CurrentSessionSearch->SearchState = EOnlineAsyncTaskState::Done;
+	TriggerOnFindSessionsCompleteDelegates(true);
+	return false;
+}
+
+bool FMockOnlineSession::FindSessionById(const FUniqueNetId& searchingUserId, const FUniqueNetId& sessionId, const FUniqueNetId& friendId, const FOnSingleSessionResultCompleteDelegate& completionDelegate)
+{
+	return false;
+}
+
+bool FMockOnlineSession::CancelFindSessions()
+{
+	if (!CurrentSessionSearch.IsValid() || CurrentSessionSearch->SearchState != EOnlineAsyncTaskState::InProgress)
+	{
+		return false;
+	}
+
+	++SearchGeneration;
+	CurrentSessionSearch->SearchState = EOnlineAsyncTaskState::Failed;
+	CurrentSessionSearch.Reset();
+
+	CompleteAfterLatency([this]()
+	{
+		TriggerOnCancelFindSessionsCompleteDelegates(true);
+	});
+
+	return true;
+}
+
+bool FMockOnlineSession::PingSearchResults(const FOnlineSessionSearchResult& searchResult)
+{
+	return false;
+}
+
+bool FMockOnlineSession::JoinSession(int32 playerNum, FName sessionName, const FOnlineSessionSearchResult& desiredSession)
+{
+	return JoinSession(*HostUserId, sessionName, desiredSession);
+}
+
+bool FMockOnlineSession::JoinSession(const FUniqueNetId& playerId, FName sessionName, const FOnlineSessionSearchResult& desiredSession)
+{
+	if (GetNamedSession(sessionName) || !desiredSession.IsValid())
+	{
+		return false;
+	}
+
+	FNamedOnlineSession* pSession = AddNamedSession(sessionName, desiredSession.Session);
+	pSession->SessionState = EOnlineSessionState::Pending;
+	pSession->bHosting = false;
+	pSession->LocalOwnerId = playerId.AsShared();
+
+	//Open slots of a backend session are checked when the join lands, the search result might be out of date
+	const FString sessionId = GetSessionIdString(desiredSession.Session);
+	const bool bBackendSession = Backend.IsValid() && Backend->IsHostedSession(sessionId);
+
+	EOnJoinSessionCompleteResult::Type result = EOnJoinSessionCompleteResult::Success;
+	if (!bBackendSession && desiredSession.Session.NumOpenPublicConnections <= 0)
+	{
+		result = EOnJoinSessionCompleteResult::SessionIsFull;
+	}
+	else if (RollFailure())
+	{
+		result = Config.JoinFailureResult;
+	}
+
+	CompleteAfterLatency([this, sessionName, result, sessionId, bBackendSession]()
+	{
+		EOnJoinSessionCompleteResult::Type joinResult = result;
+		if (bBackendSession && joinResult == EOnJoinSessionCompleteResult::Success)
+		{
+			//Clients racing for the last slot, only the first one gets it
+			joinResult = Backend->ReserveSlot(sessionId);
+		}
+
+		if (joinResult != EOnJoinSessionCompleteResult::Success)
+		{
+			RemoveNamedSession(sessionName);
+		}
+
+		TriggerOnJoinSessionCompleteDelegates(sessionName, joinResult);
+	});
+
+	return true;
+}
+
+bool FMockOnlineSession::FindFriendSession(int32 localUserNum, const FUniqueNetId& friendId)
+{
+	return false;
+}
+
+bool FMockOnlineSession::FindFriendSession(const FUniqueNetId& localUserId, const FUniqueNetId& friendId)
+{
+	return false;
+}
+
+bool FMockOnlineSession::FindFriendSession(const FUniqueNetId& localUserId, const TArray<FUniqueNetIdRef>& friendList)
+{
+	return false;
+}
+
+bool FMockOnlineSession::SendSessionInviteToFriend(int32 localUserNum, FName sessionName, const FUniqueNetId& friendId)
+{
+	return false;
+}
+
+bool FMockOnlineSession::SendSessionInviteToFriend(const FUniqueNetId& localUserId, FName sessionName, const FUniqueNetId& friendId)
+{
+	return false;
+}
+
+bool FMockOnlineSession::SendSessionInviteToFriends(int32 localUserNum, FName sessionName, const TArray<FUniqueNetIdRef>& friends)
+{
+	return false;
+}
+
+bool FMockOnlineSession::SendSessionInviteToFriends(const FUniqueNetId& localUserId, FName sessionName, const TArray<FUniqueNetIdRef>& friends)
+{
+	return false;
+}
+
+bool FMockOnlineSession::GetResolvedConnectString(FName sessionName, FString& connectInfo, FName portType)
+{
+	FNamedOnlineSession* pSession = GetNamedSession(sessionName);
+	if (!pSession || !pSession->SessionInfo.IsValid())
+	{
+		return false;
+	}
+
+	//Every session in this interface was made by it, so the session info is always the mock type
+	connectInfo = StaticCastSharedPtr<FOnlineSessionInfoMock>(pSession->SessionInfo)->GetHostAddress();
+	return true;
+}
+
+bool FMockOnlineSession::GetResolvedConnectString(const FOnlineSessionSearchResult& searchResult, FName portType, FString& connectInfo)
+{
+	if (!searchResult.Session.SessionInfo.IsValid())
+	{
+		return false;
+	}
+
+	connectInfo = StaticCastSharedPtr<FOnlineSessionInfoMock>(searchResult.Session.SessionInfo)->GetHostAddress();
+	return true;
+}
+
+FOnlineSessionSettings* FMockOnlineSession::GetSessionSettings(FName sessionName)
+{
+	FNamedOnlineSession* pSession = GetNamedSession(sessionName);
+	return pSession ? &pSession->SessionSettings : nullptr;
+}
+
+bool FMockOnlineSession::RegisterPlayer(FName sessionName, const FUniqueNetId& playerId, bool bWasInvited)
+{
+	TArray<FUniqueNetIdRef> players;
+	players.Add(playerId.AsShared());
+	return RegisterPlayers(sessionName, players, bWasInvited);
+}
+
+bool FMockOnlineSession::RegisterPlayers(FName sessionName, const TArray<FUniqueNetIdRef>& players, bool bWasInvited)
+{
+	FNamedOnlineSession* pSession = GetNamedSession(sessionName);
+	if (pSession)
+	{
+		for (const FUniqueNetIdRef& playerId : players)
+		{
+			if (!IsPlayerInSession(sessionName, *playerId))
+			{
+				pSession->RegisteredPlayers.Add(playerId);
+				pSession->NumOpenPublicConnections = FMath::Max(pSession->NumOpenPublicConnections - 1, 0);
+			}
+		}
+	}
+
+	TriggerOnRegisterPlayersCompleteDelegates(sessionName, players, pSession != nullptr);
+	return pSession != nullptr;
+}
+
+bool FMockOnlineSession::UnregisterPlayer(FName sessionName, const FUniqueNetId& playerId)
+{
+	TArray<FUniqueNetIdRef> players;
+	players.Add(playerId.AsShared());
+	return UnregisterPlayers(sessionName, players);
+}
+
+bool FMockOnlineSession::UnregisterPlayers(FName sessionName, const TArray<FUniqueNetIdRef>& players)
+{
+	FNamedOnlineSession* pSession = GetNamedSession(sessionName);
+	if (pSession)
+	{
+		for (const FUniqueNetIdRef& playerId : players)
+		{
+			const int32 numRemoved = pSession->RegisteredPlayers.RemoveAll([&playerId](const FUniqueNetIdRef& registeredId)
+			{
+				return *registeredId == *playerId;
+			});
+			pSession->NumOpenPublicConnections = FMath::Min(pSession->NumOpenPublicConnections + numRemoved, pSession->SessionSettings.NumPublicConnections);
+		}
+	}
+
+	TriggerOnUnregisterPlayersCompleteDelegates(sessionName, players, pSession != nullptr);
+	return pSession != nullptr;
+}
+
+void FMockOnlineSession::RegisterLocalPlayer(const FUniqueNetId& playerId, FName sessionName, const FOnRegisterLocalPlayerCompleteDelegate& delegate)
+{
+	delegate.ExecuteIfBound(playerId, EOnJoinSessionCompleteResult::Success);
+}
+
+void FMockOnlineSession::UnregisterLocalPlayer(const FUniqueNetId& playerId, FName sessionName, const FOnUnregisterLocalPlayerCompleteDelegate& delegate)
+{
+	delegate.ExecuteIfBound(playerId, true);
+}
+
+int32 FMockOnlineSession::GetNumSessions()
+{
+	return Sessions.Num();
+}
+
+void FMockOnlineSession::DumpSessionState()
+{
+	for (const TSharedRef<FNamedOnlineSession>& session : Sessions)
+	{
+		UE_LOG(LogMultiplayerSessions, Log, TEXT("Mock session %s: state %s, %d/%d open connections"),
+			*session->SessionName.ToString(),
+			EOnlineSessionState::ToString(session->SessionState),
+			session->NumOpenPublicConnections,
+			session->SessionSettings.NumPublicConnections);
+	}
+}
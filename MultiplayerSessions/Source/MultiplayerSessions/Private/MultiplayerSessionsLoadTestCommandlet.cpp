@@ -0,0 +1,375 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerSessionsLoadTestCommandlet.h"
+#include "MultiplayerSessions.h"
+#include "MultiplayerSessionsSubsystem.h"
+#include "MockOnlineSession.h"
+#include "SessionLatencyStats.h"
+#include "Containers/Ticker.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonSerializer.h"
+#include "Misc/FileHelper.h"
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+
+namespace MultiplayerSessionsLoadTest
+{
+	enum class EClientStep : uint8
+	{
+		Finding,
+		Joining,
+		Joined,
+		Leaving,
+		Done
+	};
+
+	struct FClient
+	{
+		UMultiplayerSessionsSubsystem* Subsystem{ nullptr };
+		EClientStep Step{ EClientStep::Done };
+		double StepStartTime{ 0.0 };
+		TFuture<FMultiplayerFindSessionsResult> Found;
+		TFuture<EOnJoinSessionCompleteResult::Type> Joined;
+		TFuture<bool> Left;
+	};
+
+	struct FReport
+	{
+		FSessionLatencyHistogram FindTimings;
+		FSessionLatencyHistogram JoinTimings;
+		FSessionLatencyHistogram LeaveTimings;
+		//Join results by EOnJoinSessionCompleteResult, plus clients that found nothing to join
+		TMap<FString, int32> JoinResults;
+		int32 NumJoinAttempts{ 0 };
+		int32 NumJoins{ 0 };
+		//Time from the first search to the last join result, summed over all waves
+		double JoinWaveSeconds{ 0.0 };
+	};
+
+	static const TCHAR* JoinResultToString(EOnJoinSessionCompleteResult::Type result)
+	{
+		switch (result)
+		{
+		case EOnJoinSessionCompleteResult::Success: return TEXT("Success");
+		case EOnJoinSessionCompleteResult::SessionIsFull: return TEXT("SessionIsFull");
+		case EOnJoinSessionCompleteResult::SessionDoesNotExist: return TEXT("SessionDoesNotExist");
+		case EOnJoinSessionCompleteResult::CouldNotRetrieveAddress: return TEXT("CouldNotRetrieveAddress");
+		case EOnJoinSessionCompleteResult::AlreadyInSession: return TEXT("AlreadyInSession");
+		default: return TEXT("UnknownError");
+		}
+	}
+
+	/*
+	* Ticks the core ticker with the real frame time until done returns true, the fake backend completes from there
+	*/
+	static bool PumpUntil(TFunctionRef<bool()> done, float timeoutSeconds)
+	{
+		double lastTime = FPlatformTime::Seconds();
+		const double deadline = lastTime + timeoutSeconds;
+		while (!done())
+		{
+			const double now = FPlatformTime::Seconds();
+			if (now > deadline)
+			{
+				return false;
+			}
+
+			FTSTicker::GetCoreTicker().Tick(float(now - lastTime));
+			lastTime = now;
+			FPlatformProcess::Sleep(0.0f);
+		}
+
+		return true;
+	}
+
+	static void AddHistogramFields(FJsonObject& jsonObject, const FString& prefix, const FSessionLatencyHistogram& histogram)
+	{
+		jsonObject.SetNumberField(prefix + TEXT("Samples"), histogram.Num());
+		jsonObject.SetNumberField(prefix + TEXT("MeanMs"), histogram.GetMeanSeconds() * 1000.0);
+		jsonObject.SetNumberField(prefix + TEXT("P50Ms"), histogram.GetPercentileSeconds(50.0f) * 1000.0);
+		jsonObject.SetNumberField(prefix + TEXT("P99Ms"), histogram.GetPercentileSeconds(99.0f) * 1000.0);
+		jsonObject.SetNumberField(prefix + TEXT("MaxMs"), histogram.GetMaxSeconds() * 1000.0);
+	}
+}
+
+UMultiplayerSessionsLoadTestCommandlet::UMultiplayerSessionsLoadTestCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UMultiplayerSessionsLoadTestCommandlet::Main(const FString& params)
+{
+	using namespace MultiplayerSessionsLoadTest;
+
+	int32 numClients = 100;
+	int32 numHosts = 1;
+	int32 numWaves = 3;
+	float timeoutSeconds = 60.0f;
+	FString matchType = TEXT("FreeForAll");
+	FString reportPath;
+	FParse::Value(*params, TEXT("Clients="), numClients);
+	FParse::Value(*params, TEXT("Hosts="), numHosts);
+	FParse::Value(*params, TEXT("Waves="), numWaves);
+	FParse::Value(*params, TEXT("Timeout="), timeoutSeconds);
+	FParse::Value(*params, TEXT("MatchType="), matchType);
+	FParse::Value(*params, TEXT("Report="), reportPath);
+	numClients = FMath::Max(numClients, 1);
+	numHosts = FMath::Max(numHosts, 1);
+	numWaves = FMath::Max(numWaves, 1);
+
+	//Enough slots for everyone by default, fewer makes clients fight over them
+	int32 numSlots = FMath::DivideAndRoundUp(numClients, numHosts);
+	FParse::Value(*params, TEXT("Slots="), numSlots);
+
+	FMockOnlineSessionConfig mockConfig = FMockOnlineSessionConfig::FromCommandLine(*params);
+	if (!FParse::Value(*params, TEXT("MockResults="), mockConfig.NumSearchResults))
+	{
+		//Only the simulated hosts, unless asked for extra noise
+		mockConfig.NumSearchResults = 0;
+	}
+	mockConfig.MatchTypes = { matchType };
+
+	TSharedRef<FMockSessionBackend, ESPMode::ThreadSafe> backend = MakeShared<FMockSessionBackend, ESPMode::ThreadSafe>();
+	auto attachBackend = [&mockConfig, &backend](UMultiplayerSessionsSubsystem* pSubsystem, int32 instanceIndex)
+	{
+		//Own seed per instance, so latency and failures don't line up between them
+		FMockOnlineSessionConfig instanceConfig = mockConfig;
+		instanceConfig.RandomSeed = mockConfig.RandomSeed + instanceIndex;
+
+		TSharedRef<FMockOnlineSession, ESPMode::ThreadSafe> mockSession = MakeShared<FMockOnlineSession, ESPMode::ThreadSafe>(instanceConfig);
+		mockSession->SetBackend(backend);
+		pSubsystem->SetSessionInterfaceOverride(mockSession);
+	};
+
+	//Hosts
+	TArray<TFuture<bool>> created;
+	for (int32 hostIndex = 0; hostIndex < numHosts; ++hostIndex)
+	{
+		UMultiplayerSessionsSubsystem* pHost = CreateSimulatedInstance(hostIndex);
+		if (!pHost)
+		{
+			DestroySimulatedInstances();
+			return 1;
+		}
+
+		attachBackend(pHost, hostIndex);
+		created.Add(pHost->CreateSessionAsync(numSlots, matchType));
+	}
+
+	const bool bHostsReady = PumpUntil([&created]()
+	{
+		return !created.ContainsByPredicate([](const TFuture<bool>& future) { return !future.IsReady(); });
+	}, timeoutSeconds);
+	if (!bHostsReady || backend->GetNumHostedSessions() <= 0)
+	{
+		UE_LOG(LogMultiplayerSessions, Error, TEXT("Load test: no host managed to create a session"));
+		DestroySimulatedInstances();
+		return 1;
+	}
+
+	//Clients
+	TArray<FClient> clients;
+	clients.SetNum(numClients);
+	for (int32 clientIndex = 0; clientIndex < numClients; ++clientIndex)
+	{
+		clients[clientIndex].Subsystem = CreateSimulatedInstance(numHosts + clientIndex);
+		if (!clients[clientIndex].Subsystem)
+		{
+			DestroySimulatedInstances();
+			return 1;
+		}
+
+		attachBackend(clients[clientIndex].Subsystem, numHosts + clientIndex);
+	}
+
+	FSessionSearchQuery query;
+	query.MaxSearchResults = 10000;
+	query.MatchType = matchType;
+
+	FReport report;
+	bool bTimedOut = false;
+	for (int32 wave = 0; wave < numWaves && !bTimedOut; ++wave)
+	{
+		//Everyone searches at once
+		const double waveStartTime = FPlatformTime::Seconds();
+		for (FClient& client : clients)
+		{
+			client.Step = EClientStep::Finding;
+			client.StepStartTime = waveStartTime;
+			client.Found = client.Subsystem->FindSessionsAsync(query);
+		}
+
+		int32 numJoinsThisWave = 0;
+		bTimedOut = !PumpUntil([&clients, &report, &numJoinsThisWave]()
+		{
+			bool bDone = true;
+			for (FClient& client : clients)
+			{
+				const double now = FPlatformTime::Seconds();
+				if (client.Step == EClientStep::Finding && client.Found.IsReady())
+				{
+					report.FindTimings.Add(now - client.StepStartTime);
+					if (client.Found.Get().bWasSuccessful && client.Subsystem->GetBestSession())
+					{
+						client.Step = EClientStep::Joining;
+						client.StepStartTime = now;
+						client.Joined = client.Subsystem->JoinBestSessionAsync();
+					}
+					else
+					{
+						++report.JoinResults.FindOrAdd(TEXT("NoSessionFound"));
+						client.Step = EClientStep::Done;
+					}
+				}
+
+				if (client.Step == EClientStep::Joining && client.Joined.IsReady())
+				{
+					const EOnJoinSessionCompleteResult::Type result = client.Joined.Get();
+					++report.NumJoinAttempts;
+					++report.JoinResults.FindOrAdd(JoinResultToString(result));
+					if (result == EOnJoinSessionCompleteResult::Success)
+					{
+						report.JoinTimings.Add(now - client.StepStartTime);
+						++numJoinsThisWave;
+						client.Step = EClientStep::Joined;
+					}
+					else
+					{
+						client.Step = EClientStep::Done;
+					}
+				}
+
+				bDone &= client.Step == EClientStep::Joined || client.Step == EClientStep::Done;
+			}
+			return bDone;
+		}, timeoutSeconds);
+
+		const double joinWaveSeconds = FPlatformTime::Seconds() - waveStartTime;
+		report.JoinWaveSeconds += joinWaveSeconds;
+		report.NumJoins += numJoinsThisWave;
+		UE_LOG(LogMultiplayerSessions, Display, TEXT("Load test wave %d: %d/%d clients joined in %.1f ms"), wave + 1, numJoinsThisWave, numClients, joinWaveSeconds * 1000.0);
+
+		//Everyone who got in leaves again, so the next wave starts from empty hosts
+		const double leaveStartTime = FPlatformTime::Seconds();
+		for (FClient& client : clients)
+		{
+			if (client.Step == EClientStep::Joined)
+			{
+				client.Step = EClientStep::Leaving;
+				client.StepStartTime = leaveStartTime;
+				client.Left = client.Subsystem->DestroySessionAsync();
+			}
+		}
+
+		bTimedOut |= !PumpUntil([&clients, &report]()
+		{
+			bool bDone = true;
+			for (FClient& client : clients)
+			{
+				if (client.Step == EClientStep::Leaving && client.Left.IsReady())
+				{
+					report.LeaveTimings.Add(FPlatformTime::Seconds() - client.StepStartTime);
+					client.Step = EClientStep::Done;
+				}
+
+				bDone &= client.Step == EClientStep::Done;
+			}
+			return bDone;
+		}, timeoutSeconds);
+	}
+
+	if (bTimedOut)
+	{
+		UE_LOG(LogMultiplayerSessions, Error, TEXT("Load test: a wave did not finish within %.0f seconds"), timeoutSeconds);
+	}
+
+	const double joinsPerSecond = report.JoinWaveSeconds > 0.0 ? report.NumJoins / report.JoinWaveSeconds : 0.0;
+	const double joinSuccessRate = report.NumJoinAttempts > 0 ? double(report.NumJoins) / report.NumJoinAttempts : 0.0;
+	UE_LOG(LogMultiplayerSessions, Display, TEXT("Load test: %d clients, %d hosts, %d waves, %d/%d joins succeeded (%.1f%%), %.1f joins/s"),
+		numClients, numHosts, numWaves, report.NumJoins, report.NumJoinAttempts, joinSuccessRate * 100.0, joinsPerSecond);
+	UE_LOG(LogMultiplayerSessions, Display, TEXT("Load test find:  p50 %.1f ms  p99 %.1f ms  max %.1f ms"),
+		report.FindTimings.GetPercentileSeconds(50.0f) * 1000.0, report.FindTimings.GetPercentileSeconds(99.0f) * 1000.0, report.FindTimings.GetMaxSeconds() * 1000.0);
+	UE_LOG(LogMultiplayerSessions, Display, TEXT("Load test join:  p50 %.1f ms  p99 %.1f ms  max %.1f ms"),
+		report.JoinTimings.GetPercentileSeconds(50.0f) * 1000.0, report.JoinTimings.GetPercentileSeconds(99.0f) * 1000.0, report.JoinTimings.GetMaxSeconds() * 1000.0);
+	for (const TPair<FString, int32>& joinResult : report.JoinResults)
+	{
+		UE_LOG(LogMultiplayerSessions, Display, TEXT("Load test join result %s: %d"), *joinResult.Key, joinResult.Value);
+	}
+
+	if (!reportPath.IsEmpty())
+	{
+		TSharedRef<FJsonObject> reportObject = MakeShared<FJsonObject>();
+		reportObject->SetNumberField(TEXT("Clients"), numClients);
+		reportObject->SetNumberField(TEXT("Hosts"), numHosts);
+		reportObject->SetNumberField(TEXT("Slots"), numSlots);
+		reportObject->SetNumberField(TEXT("Waves"), numWaves);
+		reportObject->SetBoolField(TEXT("TimedOut"), bTimedOut);
+		reportObject->SetNumberField(TEXT("JoinAttempts"), report.NumJoinAttempts);
+		reportObject->SetNumberField(TEXT("Joins"), report.NumJoins);
+		reportObject->SetNumberField(TEXT("JoinSuccessRate"), joinSuccessRate);
+		reportObject->SetNumberField(TEXT("JoinsPerSecond"), joinsPerSecond);
+		AddHistogramFields(*reportObject, TEXT("Find"), report.FindTimings);
+		AddHistogramFields(*reportObject, TEXT("Join"), report.JoinTimings);
+		AddHistogramFields(*reportObject, TEXT("Leave"), report.LeaveTimings);
+
+		TSharedRef<FJsonObject> joinResultsObject = MakeShared<FJsonObject>();
+		for (const TPair<FString, int32>& joinResult : report.JoinResults)
+		{
+			joinResultsObject->SetNumberField(joinResult.Key, joinResult.Value);
+		}
+		reportObject->SetObjectField(TEXT("JoinResults"), joinResultsObject);
+
+		FString json;
+		TSharedRef<TJsonWriter<>> writer = TJsonWriterFactory<>::Create(&json);
+		FJsonSerializer::Serialize(reportObject, writer);
+		if (!FFileHelper::SaveStringToFile(json, *reportPath))
+		{
+			UE_LOG(LogMultiplayerSessions, Error, TEXT("Load test could not write %s"), *reportPath);
+		}
+	}
+
+	DestroySimulatedInstances();
+	return bTimedOut ? 1 : 0;
+}
+
+UMultiplayerSessionsSubsystem* UMultiplayerSessionsLoadTestCommandlet::CreateSimulatedInstance(int32 instanceIndex)
+{
+	//A standalone game instance gets its own empty world and its own set of subsystems
+	UGameInstance* pGame = NewObject<UGameInstance>(GEngine);
+	GameInstances.Add(pGame);
+	pGame->InitializeStandalone(*FString::Printf(TEXT("MultiplayerSessionsLoadTest_%d"), instanceIndex));
+
+	UMultiplayerSessionsSubsystem* pSubsystem = pGame->GetSubsystem<UMultiplayerSessionsSubsystem>();
+	if (!pSubsystem)
+	{
+		UE_LOG(LogMultiplayerSessions, Error, TEXT("Load test: game instance %d has no MultiplayerSessionsSubsystem"), instanceIndex);
+	}
+
+	return pSubsystem;
+}
+
+void UMultiplayerSessionsLoadTestCommandlet::DestroySimulatedInstances()
+{
+	for (UGameInstance* pGame : GameInstances)
+	{
+		if (!pGame)
+		{
+			continue;
+		}
+
+		UWorld* pWorld = pGame->GetWorld();
+		pGame->Shutdown();
+		if (pWorld)
+		{
+			pWorld->DestroyWorld(false);
+			GEngine->DestroyWorldContext(pWorld);
+		}
+	}
+
+	GameInstances.Reset();
+}
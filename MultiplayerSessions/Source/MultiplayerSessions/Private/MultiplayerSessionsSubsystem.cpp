@@ -3,7 +3,71 @@
 
 #include "MultiplayerSessionsSubsystem.h"
 #include "OnlineSubsystem.h"
+#include "OnlineSubsystemUtils.h"
 #include "OnlineSessionSettings.h"
+#include "MockOnlineSession.h"
+#include "SessionAttributes.h"
+#include "Misc/CommandLine.h"
+#include "MultiplayerSessions.h"
+#include "MultiplayerSessionsTrace.h"
+#include "Engine/GameInstance.h"
+#include "Engine/Engine.h"
+#include "UObject/UObjectGlobals.h"
+#include "UObject/Package.h"
+#include "Misc/PackageName.h"
+#include "Algo/BinarySearch.h"
+
+static FAutoConsoleCommandWithWorld DumpLatencyStatsCommand(
+	TEXT("MultiplayerSessions.DumpLatencyStats"),
+	TEXT("Logs count, mean, p50, p99 and max duration of every session lifecycle phase"),
+	FConsoleCommandWithWorldDelegate::CreateStatic([](UWorld* pWorld)
+	{
+		UGameInstance* pGame = pWorld ? pWorld->GetGameInstance() : nullptr;
+		UMultiplayerSessionsSubsystem* pSubsystem = pGame ? pGame->GetSubsystem<UMultiplayerSessionsSubsystem>() : nullptr;
+		if (pSubsystem)
+		{
+			UE_LOG(LogMultiplayerSessions, Display, TEXT("Session latency:\n%s"), *pSubsystem->GetLatencyStats().ToString());
+		}
+	}));
+
+//Operations that are timed, Idle has no phase
+static bool GetLatencyPhase(EMultiplayerSessionState state, ESessionLatencyPhase& outPhase)
+{
+	switch (state)
+	{
+	case EMultiplayerSessionState::Creating: outPhase = ESessionLatencyPhase::Create; return true;
+	case EMultiplayerSessionState::Destroying: outPhase = ESessionLatencyPhase::Destroy; return true;
+	case EMultiplayerSessionState::Finding: outPhase = ESessionLatencyPhase::Find; return true;
+	case EMultiplayerSessionState::Joining: outPhase = ESessionLatencyPhase::Join; return true;
+	case EMultiplayerSessionState::Starting: outPhase = ESessionLatencyPhase::Start; return true;
+	default: return false;
+	}
+}
+
+//Cuts the page at offset out of the search, past MaxSearchResults of the query there is nothing to hand out
+static FMultiplayerFindSessionsPageResult MakeSessionsPage(const TSharedPtr<FOnlineSessionSearch>& sessionSearch, int32 maxSearchResults, int32 offset, int32 pageSize, bool bSearchDone)
+{
+	FMultiplayerFindSessionsPageResult pageResult;
+	pageResult.NextCursor.SessionSearch = sessionSearch;
+	pageResult.NextCursor.Offset = offset;
+	if (!sessionSearch.IsValid())
+	{
+		pageResult.NextCursor.bEndReached = true;
+		return pageResult;
+	}
+
+	const TArray<FOnlineSessionSearchResult>& searchResults = sessionSearch->SearchResults;
+	const int32 pageEnd = FMath::Min3(offset + pageSize, searchResults.Num(), maxSearchResults);
+	for (int32 resultIndex = offset; resultIndex < pageEnd; ++resultIndex)
+	{
+		pageResult.SessionResults.Add(searchResults[resultIndex]);
+	}
+
+	pageResult.NextCursor.Offset = FMath::Max(offset, pageEnd);
+	pageResult.NextCursor.bEndReached = pageResult.NextCursor.Offset >= maxSearchResults || (bSearchDone && pageResult.NextCursor.Offset >= searchResults.Num());
+	pageResult.bWasSuccessful = true;
+	return pageResult;
+}
 
 UMultiplayerSessionsSubsystem::UMultiplayerSessionsSubsystem():
 	CreateSessionCompleteDelegate(FOnCreateSessionCompleteDelegate::CreateUObject(this, &ThisClass::OnCreateSessionComplete)),
@@ -12,152 +76,1793 @@ UMultiplayerSessionsSubsystem::UMultiplayerSessionsSubsystem():
 	DestroySessionCompleteDelegate(FOnDestroySessionCompleteDelegate::CreateUObject(this, &ThisClass::OnDestroySessionComplete)),
 	StartSessionCompleteDelegate(FOnStartSessionCompleteDelegate::CreateUObject(this, &ThisClass::OnStartSessionComplete))
 {
-	IOnlineSubsystem* pSubsystem = IOnlineSubsystem::Get();
-	if (pSubsystem)
+	IndexedSearchKeys.Add(SESSION_ATTRIBUTE_MATCHTYPE);
+}
+
+void UMultiplayerSessionsSubsystem::Initialize(FSubsystemCollectionBase& collection)
+{
+	Super::Initialize(collection);
+
+	//Searches and adverts encode the match type as its position in this table
+	if (MatchTypeNames.Num() > 0)
+	{
+		FSessionAttributes::SetMatchTypeNames(MatchTypeNames);
+	}
+
+	//Run against the in-process fake backend, for perf tests without network
+	if (FParse::Param(FCommandLine::Get(), TEXT("MockSessions")))
+	{
+		SetSessionInterfaceOverride(MakeShared<FMockOnlineSession, ESPMode::ThreadSafe>(FMockOnlineSessionConfig::FromCommandLine(FCommandLine::Get())));
+	}
+
+	//Travel is started by whoever travels, it ends when the new map is loaded
+	PostLoadMapDelegateHandle = FCoreUObjectDelegates::PostLoadMapWithWorld.AddUObject(this, &ThisClass::OnPostLoadMap);
+	if (GEngine)
+	{
+		TravelFailureDelegateHandle = GEngine->OnTravelFailure().AddUObject(this, &ThisClass::OnTravelFailure);
+		NetworkFailureDelegateHandle = GEngine->OnNetworkFailure().AddUObject(this, &ThisClass::OnNetworkFailure);
+	}
+}
+
+void UMultiplayerSessionsSubsystem::Deinitialize()
+{
+	StopStreamingSearch();
+	StopSearchPrefetch();
+	ReleasePreloadedMap();
+	LanDiscovery.Reset();
+	QosProber.CancelProbe();
+	QosResponder.Reset();
+	if (OperationWatchdogTickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(OperationWatchdogTickerHandle);
+		OperationWatchdogTickerHandle.Reset();
+	}
+	ClearSessionInterfaceDelegates();
+	DetachedSessionSearch.Reset();
+	QueuedOperations.Reset();
+	CurrentState = EMultiplayerSessionState::Idle;
+	FailPendingFutures(EMultiplayerSessionState::Idle);
+
+	FCoreUObjectDelegates::PostLoadMapWithWorld.Remove(PostLoadMapDelegateHandle);
+	if (GEngine)
+	{
+		GEngine->OnTravelFailure().Remove(TravelFailureDelegateHandle);
+		GEngine->OnNetworkFailure().Remove(NetworkFailureDelegateHandle);
+	}
+
+	Super::Deinitialize();
+}
+
+void UMultiplayerSessionsSubsystem::SetSessionInterfaceOverride(IOnlineSessionPtr sessionInterface)
+{
+	//Callbacks of the old interface should not reach us anymore
+	StopStreamingSearch();
+	ClearSessionInterfaceDelegates();
+	DetachedSessionSearch.Reset();
+	QueuedOperations.Reset();
+	AbortOperationPhase();
+	CurrentState = EMultiplayerSessionState::Idle;
+	FailPendingFutures(EMultiplayerSessionState::Idle);
+	bRefreshingSearchCache = false;
+	InvalidateSearchCache();
+	SearchIndex.Clear();
+
+	//Advertised sessions belong to the old interface
+	LanDiscovery.Reset();
+	JoinedLanHostAddress.Reset();
+	QosProber.CancelProbe();
+	QosResponder.Reset();
+
+	//Without an override the online subsystem is bound again on next use
+	bSessionInterfaceOverridden = sessionInterface.IsValid();
+	OnlineSessionInterface = sessionInterface;
+	OnlineSubsystemName = NAME_None;
+}
+
+IOnlineSessionPtr UMultiplayerSessionsSubsystem::GetSessionInterface()
+{
+	ResolveSessionInterface();
+	return OnlineSessionInterface;
+}
+
+bool UMultiplayerSessionsSubsystem::ResolveSessionInterface()
+{
+	if (OnlineSessionInterface.IsValid())
+	{
+		return true;
+	}
+
+	//The class default object never talks to the backend
+	if (HasAnyFlags(RF_ClassDefaultObject))
+	{
+		return false;
+	}
+
+	//Each PIE instance and simulated client has its own world context, and with it its own online subsystem instance
+	IOnlineSubsystem* pSubsystem = Online::GetSubsystem(GetWorld());
+	if (!pSubsystem)
+	{
+		return false;
+	}
+
+	OnlineSessionInterface = pSubsystem->GetSessionInterface();
+	if (!OnlineSessionInterface.IsValid())
+	{
+		return false;
+	}
+
+	OnlineSubsystemName = pSubsystem->GetSubsystemName();
+	UE_LOG(LogMultiplayerSessions, Verbose, TEXT("Bound to session interface of online subsystem %s (%s)"), *OnlineSubsystemName.ToString(), *pSubsystem->GetInstanceName().ToString());
+	return true;
+}
+
+void UMultiplayerSessionsSubsystem::ClearSessionInterfaceDelegates()
+{
+	if (!OnlineSessionInterface.IsValid())
+	{
+		return;
+	}
+
+	OnlineSessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegateHandle);
+	OnlineSessionInterface->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegateHandle);
+	OnlineSessionInterface->ClearOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegateHandle);
+	OnlineSessionInterface->ClearOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegateHandle);
+	OnlineSessionInterface->ClearOnStartSessionCompleteDelegate_Handle(StartSessionCompleteDelegateHandle);
+}
+
+bool UMultiplayerSessionsSubsystem::GetResolvedConnectString(FString& outConnectString)
+{
+	if (!JoinedLanHostAddress.IsEmpty())
+	{
+		outConnectString = JoinedLanHostAddress;
+		return true;
+	}
+
+	return ResolveSessionInterface() && OnlineSessionInterface->GetResolvedConnectString(NAME_GameSession, outConnectString);
+}
+
+bool UMultiplayerSessionsSubsystem::IsLanMatch() const
+{
+	return !bSessionInterfaceOverridden && OnlineSubsystemName == "NULL";
+}
+
+FUniqueNetIdPtr UMultiplayerSessionsSubsystem::GetLocalUserId() const
+{
+	UWorld* pWorld = GetWorld();
+	const ULocalPlayer* pLocalPlayer = pWorld ? pWorld->GetFirstLocalPlayerFromController() : nullptr;
+	if (!pLocalPlayer)
+	{
+		return nullptr;
+	}
+
+	return pLocalPlayer->GetPreferredUniqueNetId().GetUniqueNetId();
+}
+
+void UMultiplayerSessionsSubsystem::CreateSession(int32 numPublicConnections, FString matchType)
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(UMultiplayerSessionsSubsystem::CreateSession);
+
+	if (!ResolveSessionInterface())
+	{
+		return;
+	}
+
+	EnqueueOperation(EMultiplayerSessionState::Creating, [this, numPublicConnections, matchType]()
+	{
+		StartCreateSession(numPublicConnections, matchType, false);
+	});
+}
+
+void UMultiplayerSessionsSubsystem::StartCreateSession(int32 numPublicConnections, const FString& matchType, bool bDestroyedExistingSession)
+{
+	//First, check if there is an existing session and destroy it, avoid making multiple sessions
+	//The create goes back to the front of the queue and runs once the destroy is done
+	auto pExistingSession = OnlineSessionInterface->GetNamedSession(NAME_GameSession);
+	if (pExistingSession && !bDestroyedExistingSession)
+	{
+		FQueuedSessionOperation& createOperation = QueuedOperations.InsertDefaulted_GetRef(0);
+		createOperation.Id = NextOperationId++;
+		createOperation.State = EMultiplayerSessionState::Creating;
+		createOperation.Start = [this, numPublicConnections, matchType]()
+		{
+			StartCreateSession(numPublicConnections, matchType, true);
+		};
+
+		//The destroy gets timed on its own, the create is timed again once it runs
+		AbortOperationPhase();
+		CurrentState = EMultiplayerSessionState::Destroying;
+		CurrentOperationId = NextOperationId++;
+		TraceOperation(CurrentState, ESessionTraceStage::Started, NAME_GameSession, -1, true);
+		LatencyStats.BeginPhase(ESessionLatencyPhase::Destroy);
+		ArmOperationDeadline();
+		StartDestroySession();
+		return;
+	}
+
+	//Nobody could search for a match type that is not in the table
+	FSessionAttributes attributes;
+	if (!FSessionAttributes::Make(matchType, attributes))
+	{
+		UE_LOG(LogMultiplayerSessions, Error, TEXT("Can't create a session with match type %s, add it to MatchTypeNames under [/Script/MultiplayerSessions.MultiplayerSessionsSubsystem] in the game config"), *matchType);
+		BroadcastCreateSessionComplete(false);
+		FinishOperation();
+		return;
+	}
+
+	//Hosting now, a LAN host joined before is left behind
+	JoinedLanHostAddress.Reset();
+
+	//Add delegate CreateSessionComplete and store the handle (needs to be stored so it can be removed)
+	CreateSessionCompleteDelegateHandle = OnlineSessionInterface->AddOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegate);
+
+	//A dedicated server has no player to attach presence or a lobby to, it advertises under the server identity
+	const bool bDedicated = IsDedicatedServerHost();
+
+	//Create session
+	LastSessionSettings = MakeShareable(new FOnlineSessionSettings());
+	LastSessionSettings->bIsLANMatch = IsLanMatch();
+	LastSessionSettings->bIsDedicated = bDedicated;
+	LastSessionSettings->NumPublicConnections = numPublicConnections;
+	//Join an on-going session
+	LastSessionSettings->bAllowJoinInProgress = true;
+	LastSessionSettings->bAllowJoinViaPresence = !bDedicated;
+	LastSessionSettings->bShouldAdvertise = true;
+	LastSessionSettings->bUsesPresence = !bDedicated;
+	LastSessionSettings->bUseLobbiesIfAvailable = !bDedicated;
+	attributes.WriteTo(*LastSessionSettings);
+	LastSessionSettings->BuildUniqueId = FSessionAttributes::BuildUniqueId;
+
+	//Without a local player the interface picks the user by index, on a dedicated server index 0 is the server itself
+	const FUniqueNetIdPtr localUserId = bDedicated ? nullptr : GetLocalUserId();
+	const bool bCreated = localUserId.IsValid()
+		? OnlineSessionInterface->CreateSession(*localUserId, NAME_GameSession, *LastSessionSettings)
+		: OnlineSessionInterface->CreateSession(0, NAME_GameSession, *LastSessionSettings);
+	if (!bCreated)
+	{
+		//Session not created
+		//Remove delegate
+		OnlineSessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegateHandle);
+
+		//Broadcast custom delegate
+		BroadcastCreateSessionComplete(false);
+		FinishOperation();
+	}
+}
+
+void UMultiplayerSessionsSubsystem::FindSessions(int32 maxSearchResults)
+{
+	FSessionSearchQuery query;
+	query.MaxSearchResults = maxSearchResults;
+	FindSessions(query);
+}
+
+void UMultiplayerSessionsSubsystem::FindSessions(const FSessionSearchQuery& query)
+{
+	FindSessionsInternal(query, false, 0);
+}
+
+void UMultiplayerSessionsSubsystem::FindSessionsStreaming(const FSessionSearchQuery& query, int32 earlyExitMatchCount)
+{
+	FindSessionsInternal(query, true, earlyExitMatchCount);
+}
+
+void UMultiplayerSessionsSubsystem::FindSessionsPage(const FSessionSearchQuery& query, int32 pageSize, const FSessionSearchCursor& cursor)
+{
+	TWeakObjectPtr<UMultiplayerSessionsSubsystem> weakThis(this);
+	FindSessionsPageAsync(query, pageSize, cursor).Next([weakThis](FMultiplayerFindSessionsPageResult&& pageResult)
+	{
+		//Pending futures resolve while we are torn down, nobody is listening anymore then
+		if (weakThis.IsValid())
+		{
+			weakThis->MultiplayerOnFindSessionsPageComplete.Broadcast(pageResult.SessionResults, pageResult.NextCursor, pageResult.bWasSuccessful);
+		}
+	});
+}
+
+void UMultiplayerSessionsSubsystem::FindSessionsInternal(const FSessionSearchQuery& query, bool bStreaming, int32 earlyExitMatchCount, TPromise<FMultiplayerFindSessionsResult>* pPromise, FFindSessionsPagePromise* pPagePromise)
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(UMultiplayerSessionsSubsystem::FindSessionsInternal);
+
+	if (!ResolveSessionInterface())
+	{
+		return;
+	}
+
+	if (CanUseSearchCache(query))
+	{
+		//Cached results are handed back right away, stale ones get refreshed in the background
+		const double cacheAge = FPlatformTime::Seconds() - CachedSearchTime;
+		if (cacheAge > SearchCacheTimeToLive && !IsOperationPending(EMultiplayerSessionState::Finding) && !DetachedSessionSearch.IsValid())
+		{
+			EnqueueSearch(CachedSearchQuery, false, 0, true, nullptr);
+		}
+
+		//Answered like a search of its own, so the futures and trace events of this call are told apart from the others
+		const uint32 searchId = NextOperationId++;
+		AddSearchPromises(searchId, pPromise, pPagePromise);
+
+		//The cache can hold a wider search than this one, hand out and rank no more than the query asks for
+		PrepareSearchResults(CachedSessionSearch, query);
+		const int32 numResults = FMath::Clamp(query.MaxSearchResults, 0, CachedSessionSearch->SearchResults.Num());
+		BroadcastFindSessionsComplete(TArray<FOnlineSessionSearchResult>(CachedSessionSearch->SearchResults.GetData(), numResults), true, searchId);
+		return;
+	}
+
+	EnqueueSearch(query, bStreaming, earlyExitMatchCount, false, pPromise, pPagePromise);
+}
+
+//0 waits for the full search, so it wins over any early exit
+static int32 MergeEarlyExitMatchCount(int32 earlyExitMatchCount, int32 otherEarlyExitMatchCount)
+{
+	if (earlyExitMatchCount <= 0 || otherEarlyExitMatchCount <= 0)
+	{
+		return 0;
+	}
+
+	return FMath::Max(earlyExitMatchCount, otherEarlyExitMatchCount);
+}
+
+uint32 UMultiplayerSessionsSubsystem::EnqueueSearch(const FSessionSearchQuery& query, bool bStreaming, int32 earlyExitMatchCount, bool bSilent, TPromise<FMultiplayerFindSessionsResult>* pPromise, FFindSessionsPagePromise* pPagePromise)
+{
+	//A caller that doesn't stream waits for every result
+	if (!bStreaming)
+	{
+		earlyExitMatchCount = 0;
+	}
+
+	uint32 searchId = 0;
+	if (CurrentState == EMultiplayerSessionState::Finding && LastSearchQuery.Covers(query))
+	{
+		//The running search finds everything this one would, let it report to the caller instead of searching twice
+		if (!bSilent)
+		{
+			bRefreshingSearchCache = false;
+			if (bStreamingSearch)
+			{
+				StreamingEarlyExitMatchCount = MergeEarlyExitMatchCount(StreamingEarlyExitMatchCount, earlyExitMatchCount);
+			}
+		}
+
+		searchId = CurrentOperationId;
+		TraceOperation(EMultiplayerSessionState::Finding, ESessionTraceStage::Coalesced, NAME_None, -1, true);
+	}
+	else
+	{
+		FQueuedSessionOperation* pQueuedSearch = QueuedOperations.FindByPredicate([&query](const FQueuedSessionOperation& operation)
+		{
+			return operation.State == EMultiplayerSessionState::Finding && (operation.SearchQuery.Covers(query) || query.Covers(operation.SearchQuery));
+		});
+
+		if (pQueuedSearch)
+		{
+			//Widen the queued search when this one asks for more, everyone waiting on it gets the wider results
+			if (!pQueuedSearch->SearchQuery.Covers(query))
+			{
+				pQueuedSearch->SearchQuery = query;
+			}
+			pQueuedSearch->EarlyExitMatchCount = MergeEarlyExitMatchCount(pQueuedSearch->bStreaming ? pQueuedSearch->EarlyExitMatchCount : 0, earlyExitMatchCount);
+			pQueuedSearch->bStreaming |= bStreaming;
+			pQueuedSearch->bSilent &= bSilent;
+			SetSearchStart(*pQueuedSearch);
+
+			searchId = pQueuedSearch->Id;
+			FMultiplayerSessionsTrace::OutputOperation(searchId, (uint8)EMultiplayerSessionState::Finding, ESessionTraceStage::Coalesced, NAME_None, -1, true);
+		}
+	}
+
+	if (searchId != 0)
+	{
+		AddSearchPromises(searchId, pPromise, pPagePromise);
+		return searchId;
+	}
+
+	//Nothing covers it, a search of its own that runs after the queued ones
+	FQueuedSessionOperation& operation = QueuedOperations.AddDefaulted_GetRef();
+	operation.Id = NextOperationId++;
+	operation.State = EMultiplayerSessionState::Finding;
+	operation.SearchQuery = query;
+	operation.bStreaming = bStreaming;
+	operation.EarlyExitMatchCount = earlyExitMatchCount;
+	operation.bSilent = bSilent;
+	SetSearchStart(operation);
+
+	searchId = operation.Id;
+	FMultiplayerSessionsTrace::OutputOperation(searchId, (uint8)EMultiplayerSessionState::Finding, ESessionTraceStage::Queued, NAME_None, -1, true);
+
+	//Registered before the search runs, it might complete right away
+	AddSearchPromises(searchId, pPromise, pPagePromise);
+
+	StartNextOperation();
+	return searchId;
+}
+
+void UMultiplayerSessionsSubsystem::AddSearchPromises(uint32 searchId, TPromise<FMultiplayerFindSessionsResult>* pPromise, FFindSessionsPagePromise* pPagePromise)
+{
+	if (pPromise)
+	{
+		FindSessionsPromises.Add({ searchId, MoveTemp(*pPromise) });
+	}
+
+	if (pPagePromise)
+	{
+		pPagePromise->SearchId = searchId;
+		FindSessionsPagePromises.Add(MoveTemp(*pPagePromise));
+	}
+}
+
+void UMultiplayerSessionsSubsystem::SetSearchStart(FQueuedSessionOperation& operation)
+{
+	operation.Start = [this, query = operation.SearchQuery, bStreaming = operation.bStreaming, earlyExitMatchCount = operation.EarlyExitMatchCount, bSilent = operation.bSilent]()
+	{
+		StartFindSessions(query, bStreaming, earlyExitMatchCount, bSilent);
+	};
+}
+
+void UMultiplayerSessionsSubsystem::StartFindSessions(const FSessionSearchQuery& query, bool bStreaming, int32 earlyExitMatchCount, bool bSilent)
+{
+	bRefreshingSearchCache = bSilent;
+
+	if (!StartSessionSearch(query))
+	{
+		if (!bSilent)
+		{
+			//Broadcast custom delegate
+			BroadcastFindSessionsComplete(TArray<FOnlineSessionSearchResult>(), false, CurrentOperationId);
+		}
+
+		bRefreshingSearchCache = false;
+		FinishOperation();
+		return;
+	}
+
+	if (!bStreaming)
+	{
+		return;
+	}
+
+	StopStreamingSearch();
+	StreamingEarlyExitMatchCount = earlyExitMatchCount;
+	NumStreamedResults = 0;
+	SearchIndex.Reset(LastSessionSearch, IndexedSearchKeys);
+	bStreamingSearch = true;
+	StreamingSearchTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::TickStreamingSearch));
+}
+
+bool UMultiplayerSessionsSubsystem::TickStreamingSearch(float deltaTime)
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(UMultiplayerSessionsSubsystem::TickStreamingSearch);
+
+	if (!LastSessionSearch.IsValid())
+	{
+		bStreamingSearch = false;
+		return false;
+	}
+
+	BroadcastStreamedResults();
+
+	//Pages cut from this search go out as soon as it found enough for them
+	if (FindSessionsPagePromises.Num() > 0)
+	{
+		ResolveSearchPages(CurrentOperationId, LastSessionSearch, false);
+
+		//Whoever got a page might have cancelled the search already
+		if (!bStreamingSearch)
+		{
+			return false;
+		}
+	}
+
+	if (!IsSearchInProgress())
+	{
+		//Search finished, OnFindSessionsComplete reports the rest
+		return true;
+	}
+
+	//Without a match type every result counts
+	const int32 numMatches = LastSearchQuery.MatchType.IsEmpty()
+		? SearchIndex.Num()
+		: SearchIndex.FindResults(SESSION_ATTRIBUTE_MATCHTYPE, FSessionAttributes::GetMatchTypeIndexValue(LastSearchQuery.MatchType)).Num();
+	if (StreamingEarlyExitMatchCount <= 0 || numMatches < StreamingEarlyExitMatchCount)
+	{
+		return true;
+	}
+
+	//Found enough matches, no need to wait for the slowest replies
+	//Clear the delegate first, some backends complete the search from inside the cancel
+	bStreamingSearch = false;
+	StreamingSearchTickerHandle.Reset();
+	OnlineSessionInterface->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegateHandle);
+	if (!CancelBackendSearch() && IsSearchInProgress())
+	{
+		//Backend can't cancel, the rest of the search completes in the background and only fills the cache
+		DetachRunningSearch();
+	}
+	bRefreshingSearchCache = false;
+
+	//The caller has its results now, whatever the backend still does is not part of the wait
+	LatencyStats.EndPhase(ESessionLatencyPhase::Find);
+
+	FilterNewSearchResults();
+	PrepareSearchResults(LastSessionSearch, LastSearchQuery);
+	BroadcastFindSessionsComplete(LastSessionSearch->SearchResults, true, CurrentOperationId);
+	FinishOperation();
+	return false;
+}
+
+void UMultiplayerSessionsSubsystem::BroadcastStreamedResults()
+{
+	FilterNewSearchResults();
+
+	//Backends add results to the search object as replies come in, everything past the last count is new
+	const TArray<FOnlineSessionSearchResult>& searchResults = LastSessionSearch->SearchResults;
+	if (searchResults.Num() <= NumStreamedResults)
+	{
+		return;
+	}
+
+	TArrayView<const FOnlineSessionSearchResult> batch(searchResults.GetData() + NumStreamedResults, searchResults.Num() - NumStreamedResults);
+	NumStreamedResults = searchResults.Num();
+
+	//Index the new results before anyone hears about them
+	SearchIndex.Update();
+	MultiplayerOnFindSessionsBatch.Broadcast(batch);
+}
+
+void UMultiplayerSessionsSubsystem::StopStreamingSearch()
+{
+	bStreamingSearch = false;
+	if (StreamingSearchTickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(StreamingSearchTickerHandle);
+		StreamingSearchTickerHandle.Reset();
+	}
+}
+
+bool UMultiplayerSessionsSubsystem::StartSessionSearch(const FSessionSearchQuery& query)
+{
+	if (ShouldUseLanDiscovery())
+	{
+		return StartLanDiscoverySearch(query);
+	}
+
+	FindSessionsCompleteDelegateHandle = OnlineSessionInterface->AddOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegate);
+
+	LastSearchQuery = query;
+	LastSessionSearch = MakeShareable(new FOnlineSessionSearch());
+	LastSessionSearch->bIsLanQuery = IsLanMatch();
+	NumFilteredResults = 0;
+	//Match type and attribute filters go to the backend, so it filters before sending results
+	query.ApplyTo(*LastSessionSearch);
+
+	const FUniqueNetIdPtr localUserId = GetLocalUserId();
+	const bool bSearching = localUserId.IsValid()
+		? OnlineSessionInterface->FindSessions(*localUserId, LastSessionSearch.ToSharedRef())
+		: OnlineSessionInterface->FindSessions(0, LastSessionSearch.ToSharedRef());
+	if (!bSearching)
+	{
+		//No sessions found
+		//Remove delegate
+		OnlineSessionInterface->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegateHandle);
+		return false;
+	}
+
+	return true;
+}
+
+bool UMultiplayerSessionsSubsystem::ShouldUseLanDiscovery() const
+{
+	return bFastLanDiscovery && IsLanMatch();
+}
+
+FLanSessionDiscovery& UMultiplayerSessionsSubsystem::GetLanDiscovery()
+{
+	if (!LanDiscovery.IsValid())
+	{
+		LanDiscovery = MakeUnique<FLanSessionDiscovery>(LanDiscoveryGroup, LanDiscoveryPort);
+	}
+	return *LanDiscovery;
+}
+
+bool UMultiplayerSessionsSubsystem::StartLanDiscoverySearch(const FSessionSearchQuery& query)
+{
+	LastSearchQuery = query;
+	LastSessionSearch = MakeShareable(new FOnlineSessionSearch());
+	LastSessionSearch->bIsLanQuery = true;
+	NumFilteredResults = 0;
+	query.ApplyTo(*LastSessionSearch);
+
+	//Hosts only answer queries for their match type and build, the rest of the query is checked as replies come in
+	FLanSessionDiscoveryQuery lanQuery;
+	lanQuery.MatchType = query.MatchType.IsEmpty() ? 0 : FSessionAttributes::PackMatchType(query.MatchType);
+	lanQuery.BuildUniqueId = FSessionAttributes::BuildUniqueId;
+	lanQuery.MaxResults = query.MaxSearchResults;
+	lanQuery.TimeoutSeconds = LanDiscoveryTimeoutSeconds;
+	lanQuery.QuietSeconds = LanDiscoveryQuietSeconds;
+
+	const bool bQuerying = GetLanDiscovery().StartQuery(lanQuery,
+		FLanSessionDiscovery::FOnHostFound::CreateUObject(this, &ThisClass::OnLanHostFound),
+		FLanSessionDiscovery::FOnDiscoveryComplete::CreateUObject(this, &ThisClass::OnLanDiscoveryComplete));
+	if (!bQuerying)
+	{
+		return false;
+	}
+
+	//Streaming searches pick up the replies from the search like they do for any other backend
+	LastSessionSearch->SearchState = EOnlineAsyncTaskState::InProgress;
+	return true;
+}
+
+void UMultiplayerSessionsSubsystem::OnLanHostFound(const FOnlineSessionSearchResult& result)
+{
+	//Filter before the result is added, so it can never end up in a batch or a page
+	if (LastSessionSearch.IsValid() && LastSearchQuery.Matches(result))
+	{
+		LastSessionSearch->SearchResults.Add(result);
+		NumFilteredResults = LastSessionSearch->SearchResults.Num();
+	}
+}
+
+void UMultiplayerSessionsSubsystem::OnLanDiscoveryComplete(bool bWasSuccessful)
+{
+	if (LastSessionSearch.IsValid())
+	{
+		LastSessionSearch->SearchState = bWasSuccessful ? EOnlineAsyncTaskState::Done : EOnlineAsyncTaskState::Failed;
+	}
+
+	OnFindSessionsComplete(bWasSuccessful);
+}
+
+bool UMultiplayerSessionsSubsystem::FillLanAdvert(FLanSessionAdvert& outAdvert)
+{
+	FNamedOnlineSession* pSession = OnlineSessionInterface.IsValid() ? OnlineSessionInterface->GetNamedSession(NAME_GameSession) : nullptr;
+	if (!pSession)
+	{
+		return false;
+	}
+
+	FSessionAttributes attributes;
+	if (!FSessionAttributes::Read(pSession->SessionSettings, attributes))
+	{
+		return false;
+	}
+
+	outAdvert.MatchType = attributes.Pack();
+	outAdvert.OwningUserName = pSession->OwningUserName;
+	outAdvert.BuildUniqueId = pSession->SessionSettings.BuildUniqueId;
+	outAdvert.OpenSlots = pSession->NumOpenPublicConnections;
+	outAdvert.MaxSlots = pSession->SessionSettings.NumPublicConnections;
+
+	//Until the listen server is up, clients will connect to the default port
+	UWorld* pWorld = GetWorld();
+	outAdvert.GamePort = pWorld && pWorld->GetNetDriver() ? pWorld->URL.Port : FURL::UrlConfig.DefaultPort;
+	return true;
+}
+
+bool UMultiplayerSessionsSubsystem::CancelBackendSearch()
+{
+	if (LanDiscovery.IsValid() && LanDiscovery->IsQuerying())
+	{
+		LanDiscovery->StopQuery();
+		if (LastSessionSearch.IsValid())
+		{
+			LastSessionSearch->SearchState = EOnlineAsyncTaskState::Done;
+		}
+		return true;
+	}
+
+	return OnlineSessionInterface->CancelFindSessions();
+}
+
+void UMultiplayerSessionsSubsystem::FilterNewSearchResults()
+{
+	TArray<FOnlineSessionSearchResult>& searchResults = LastSessionSearch->SearchResults;
+
+	//LAN beacons answer every query, so apply the filter the backend would have applied
+	//Only results nobody has seen yet are removed, the ones before keep their index so page offsets stay valid
+	if (LastSessionSearch->bIsLanQuery && LastSearchQuery.HasFilters() && NumFilteredResults < searchResults.Num())
+	{
+		int32 numKept = NumFilteredResults;
+		for (int32 resultIndex = NumFilteredResults; resultIndex < searchResults.Num(); ++resultIndex)
+		{
+			if (!LastSearchQuery.Matches(searchResults[resultIndex]))
+			{
+				continue;
+			}
+
+			if (numKept != resultIndex)
+			{
+				searchResults[numKept] = MoveTemp(searchResults[resultIndex]);
+			}
+			++numKept;
+		}
+
+		if (numKept < searchResults.Num())
+		{
+			//Indices moved under an index that already got to them, index from scratch
+			if (SearchIndex.GetSessionSearch() == LastSessionSearch && SearchIndex.Num() > NumFilteredResults)
+			{
+				SearchIndex.Reset(LastSessionSearch, IndexedSearchKeys);
+			}
+			searchResults.RemoveAt(numKept, searchResults.Num() - numKept, false);
+		}
+	}
+
+	NumFilteredResults = searchResults.Num();
+}
+
+void UMultiplayerSessionsSubsystem::PrepareSearchResults(const TSharedPtr<FOnlineSessionSearch>& sessionSearch, const FSessionSearchQuery& query)
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(UMultiplayerSessionsSubsystem::PrepareSearchResults);
+
+	if (SearchIndex.GetSessionSearch() != sessionSearch)
+	{
+		SearchIndex.Reset(sessionSearch, IndexedSearchKeys);
+	}
+
+	SearchIndex.Update();
+
+	//Rank only the sessions with the wanted match type, straight from the index
+	//Results past the MaxSearchResults of the query are not handed out, e.g. the rest of a wider cached search
+	const TArrayView<const FOnlineSessionSearchResult> searchResults(sessionSearch->SearchResults.GetData(), FMath::Clamp(query.MaxSearchResults, 0, sessionSearch->SearchResults.Num()));
+	SessionRanker.Weights = RankingWeights;
+	RankedSessionSearch = sessionSearch;
+	if (query.MatchType.IsEmpty())
+	{
+		SessionRanker.RankTopK(searchResults, RankingTopK, RankedSessions);
+	}
+	else
+	{
+		//Buckets list their results in search order, the ones handed out come first
+		TArrayView<const int32> candidates = SearchIndex.FindResults(SESSION_ATTRIBUTE_MATCHTYPE, FSessionAttributes::GetMatchTypeIndexValue(query.MatchType));
+		candidates = candidates.Slice(0, Algo::LowerBound(candidates, searchResults.Num()));
+		SessionRanker.RankTopK(searchResults, candidates, RankingTopK, RankedSessions);
+	}
+}
+
+const FOnlineSessionSearchResult* UMultiplayerSessionsSubsystem::GetBestSession() const
+{
+	if (RankedSessions.Num() <= 0 || !SearchIndex.GetSessionSearch().IsValid())
+	{
+		return nullptr;
+	}
+
+	return &SearchIndex.GetResult(RankedSessions[0].ResultIndex);
+}
+
+bool UMultiplayerSessionsSubsystem::CanUseSearchCache(const FSessionSearchQuery& query) const
+{
+	if (SearchCacheTimeToLive <= 0.0f || !CachedSessionSearch.IsValid())
+	{
+		return false;
+	}
+
+	//A smaller search with the same filters is covered by the cache, anything else is not
+	if (!CachedSearchQuery.Covers(query) || CachedSessionSearch->bIsLanQuery != IsLanMatch())
+	{
+		return false;
+	}
+
+	const double cacheAge = FPlatformTime::Seconds() - CachedSearchTime;
+	return cacheAge <= FMath::Max(SearchCacheTimeToLive, SearchCacheMaxStaleSeconds);
+}
+
+void UMultiplayerSessionsSubsystem::SetSearchCacheTimeToLive(float timeToLiveSeconds, float maxStaleSeconds)
+{
+	SearchCacheTimeToLive = timeToLiveSeconds;
+	SearchCacheMaxStaleSeconds = maxStaleSeconds;
+}
+
+void UMultiplayerSessionsSubsystem::InvalidateSearchCache()
+{
+	CachedSessionSearch.Reset();
+	CachedSearchTime = 0.0;
+}
+
+bool UMultiplayerSessionsSubsystem::IsSearchInProgress() const
+{
+	return LastSessionSearch.IsValid() && LastSessionSearch->SearchState == EOnlineAsyncTaskState::InProgress;
+}
+
+void UMultiplayerSessionsSubsystem::StartSearchPrefetch(const FSessionSearchQuery& query)
+{
+	StopSearchPrefetch();
+	SearchPrefetchQuery = query;
+
+	//Search right away, the menu just opened and the player might click Join any moment
+	TickSearchPrefetch(0.0f);
+	SearchPrefetchTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::TickSearchPrefetch), FMath::Max(SearchPrefetchIntervalSeconds, 0.0f));
+}
+
+void UMultiplayerSessionsSubsystem::StopSearchPrefetch()
+{
+	if (SearchPrefetchTickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(SearchPrefetchTickerHandle);
+		SearchPrefetchTickerHandle.Reset();
+	}
+}
+
+void UMultiplayerSessionsSubsystem::PreloadMap(const FString& mapPath)
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(UMultiplayerSessionsSubsystem::PreloadMap);
+
+	//Travel URLs carry options, e.g. ?listen
+	FString packageNameString;
+	mapPath.Split(TEXT("?"), &packageNameString, nullptr);
+	if (packageNameString.IsEmpty())
+	{
+		packageNameString = mapPath;
+	}
+
+	if (!FPackageName::IsValidLongPackageName(packageNameString))
+	{
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("Can't preload %s, it is not a long package name"), *mapPath);
+		return;
+	}
+
+	UWorld* pWorld = GetWorld();
+	if (pWorld && pWorld->WorldType == EWorldType::PIE)
+	{
+		return;
+	}
+
+	const FName packageName(*packageNameString);
+	if (packageName == PreloadMapName)
+	{
+		return;
+	}
+
+	ReleasePreloadedMap();
+	PreloadMapName = packageName;
+
+	//Already in memory, e.g. the map we are on, only hold on to it
+	UPackage* pPackage = FindPackage(nullptr, *packageNameString);
+	if (pPackage && pPackage->IsFullyLoaded())
+	{
+		PreloadedMapPackage = pPackage;
+		return;
+	}
+
+	PreloadMapStartTime = FPlatformTime::Seconds();
+	LoadPackageAsync(packageNameString, FLoadPackageAsyncDelegate::CreateUObject(this, &ThisClass::OnMapPreloaded));
+}
+
+void UMultiplayerSessionsSubsystem::ReleasePreloadedMap()
+{
+	//A load still in flight completes, but isn't held on to
+	PreloadedMapPackage = nullptr;
+	PreloadMapName = NAME_None;
+}
+
+void UMultiplayerSessionsSubsystem::OnMapPreloaded(const FName& packageName, UPackage* pPackage, EAsyncLoadingResult::Type result)
+{
+	//Released or replaced by another map in the meantime
+	if (packageName != PreloadMapName)
+	{
+		return;
+	}
+
+	if (result != EAsyncLoadingResult::Succeeded || !pPackage)
+	{
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("Preloading %s failed"), *packageName.ToString());
+		PreloadMapName = NAME_None;
+		return;
+	}
+
+	PreloadedMapPackage = pPackage;
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Preloaded %s in %.1f ms"), *packageName.ToString(), (FPlatformTime::Seconds() - PreloadMapStartTime) * 1000.0);
+}
+
+bool UMultiplayerSessionsSubsystem::TickSearchPrefetch(float deltaTime)
+{
+	//Without a cache there is nothing to keep warm
+	//Low priority, anything the player asked for goes first, and a detached search refreshes the cache anyway
+	if (SearchCacheTimeToLive <= 0.0f || !ResolveSessionInterface() || CurrentState != EMultiplayerSessionState::Idle || QueuedOperations.Num() > 0 || DetachedSessionSearch.IsValid())
+	{
+		return true;
+	}
+
+	//Still fresh, nothing to do until the next interval
+	const double cacheAge = FPlatformTime::Seconds() - CachedSearchTime;
+	if (CanUseSearchCache(SearchPrefetchQuery) && cacheAge <= SearchCacheTimeToLive)
+	{
+		return true;
+	}
+
+	EnqueueSearch(SearchPrefetchQuery, false, 0, true, nullptr);
+	return true;
+}
+
+void UMultiplayerSessionsSubsystem::JoinsSession(const FOnlineSessionSearchResult& result)
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(UMultiplayerSessionsSubsystem::JoinsSession);
+
+	if (!ResolveSessionInterface())
+	{
+		BroadcastJoinSessionComplete(EOnJoinSessionCompleteResult::UnknownError);
+		return;
+	}
+
+	EnqueueOperation(EMultiplayerSessionState::Joining, [this, result]()
+	{
+		//A session picked by the caller, no fallback to other candidates
+		NextJoinCandidate = INDEX_NONE;
+		JoinSessionInternal(result);
+	});
+}
+
+void UMultiplayerSessionsSubsystem::JoinBestSession()
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(UMultiplayerSessionsSubsystem::JoinBestSession);
+
+	if (!ResolveSessionInterface())
+	{
+		BroadcastJoinSessionComplete(EOnJoinSessionCompleteResult::UnknownError);
+		return;
+	}
+
+	//The best session is picked when the join runs, so a search that finishes in between is taken into account
+	EnqueueOperation(EMultiplayerSessionState::Joining, [this]()
+	{
+		//Measure the best candidates ourselves first, the join goes on once the probes are back
+		if (bQosProbeBeforeJoin && StartQosProbe())
+		{
+			return;
+		}
+
+		JoinBestRankedSession();
+	});
+}
+
+void UMultiplayerSessionsSubsystem::JoinBestRankedSession()
+{
+	const FOnlineSessionSearchResult* pBestSession = GetBestSession();
+	if (!pBestSession)
+	{
+		BroadcastJoinSessionComplete(EOnJoinSessionCompleteResult::SessionDoesNotExist);
+		FinishOperation();
+		return;
+	}
+
+	NextJoinCandidate = 1;
+	JoinAttemptsLeft = FMath::Max(MaxJoinAttempts, 1) - 1;
+	JoinSessionInternal(*pBestSession);
+}
+
+bool UMultiplayerSessionsSubsystem::StartQosProbe()
+{
+	//A single candidate leaves nothing to choose between
+	const int32 numCandidates = FMath::Min(QosProbeCandidates, RankedSessions.Num());
+	if (numCandidates < 2 || !SearchIndex.GetSessionSearch().IsValid())
+	{
+		return false;
+	}
+
+	TArray<FSessionQosTarget> targets;
+	TArray<FString> sessionIds;
+	for (int32 candidateIndex = 0; candidateIndex < numCandidates; ++candidateIndex)
+	{
+		const FOnlineSessionSearchResult& result = SearchIndex.GetResult(RankedSessions[candidateIndex].ResultIndex);
+		FSessionQosTarget& target = targets.AddDefaulted_GetRef();
+		target.SessionId = result.GetSessionIdStr();
+		if (!GetQosProbeAddress(result, target.Address))
+		{
+			targets.Pop();
+			continue;
+		}
+		sessionIds.Add(target.SessionId);
+	}
+
+	FSessionQosProbeSettings settings;
+	settings.ProbesPerTarget = QosProbesPerCandidate;
+	settings.TimeoutSeconds = QosProbeTimeoutSeconds;
+
+	QosProbeOperationId = CurrentOperationId;
+	return QosProber.StartProbe(targets, settings, FSessionQosProber::FOnProbeComplete::CreateUObject(this, &ThisClass::OnQosProbeComplete, MoveTemp(sessionIds)));
+}
+
+void UMultiplayerSessionsSubsystem::OnQosProbeComplete(const TArray<FSessionQosMeasurement>& measurements, TArray<FString> sessionIds)
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(UMultiplayerSessionsSubsystem::OnQosProbeComplete);
+
+	//The join timed out or was dropped while the probes were out
+	if (CurrentState != EMultiplayerSessionState::Joining || CurrentOperationId != QosProbeOperationId)
+	{
+		return;
+	}
+
+	for (int32 targetIndex = 0; targetIndex < measurements.Num(); ++targetIndex)
+	{
+		if (measurements[targetIndex].WasProbed())
+		{
+			SessionRanker.SetQosMeasurement(sessionIds[targetIndex], measurements[targetIndex]);
+		}
+	}
+
+	//Only the cost of the probed candidates changes, the others keep theirs
+	for (FRankedSession& rankedSession : RankedSessions)
+	{
+		SessionRanker.ScoreResult(SearchIndex.GetResult(rankedSession.ResultIndex), rankedSession.Cost);
+	}
+	RankedSessions.Sort([](const FRankedSession& a, const FRankedSession& b)
+	{
+		return a.Cost < b.Cost;
+	});
+
+	JoinBestRankedSession();
+}
+
+bool UMultiplayerSessionsSubsystem::GetQosProbeAddress(const FOnlineSessionSearchResult& result, FString& outAddress)
+{
+	FString connectString;
+	if (!FLanSessionDiscovery::GetHostAddress(result, connectString) && !OnlineSessionInterface->GetResolvedConnectString(result, NAME_GamePort, connectString))
+	{
+		return false;
+	}
+
+	//Probes go to the responder of the host instead of its game port
+	FString hostAddress = connectString;
+	connectString.Split(TEXT(":"), &hostAddress, nullptr, ESearchCase::CaseSensitive, ESearchDir::FromEnd);
+	outAddress = FString::Printf(TEXT("%s:%d"), *hostAddress, QosPort);
+	return true;
+}
+
+bool UMultiplayerSessionsSubsystem::TryJoinNextCandidate()
+{
+	if (NextJoinCandidate == INDEX_NONE || JoinAttemptsLeft <= 0 || !RankedSessions.IsValidIndex(NextJoinCandidate))
+	{
+		NextJoinCandidate = INDEX_NONE;
+		return false;
+	}
+
+	const FRankedSession& candidate = RankedSessions[NextJoinCandidate];
+	++NextJoinCandidate;
+	--JoinAttemptsLeft;
+	ArmOperationDeadline();
+
+	JoinSessionInternal(SearchIndex.GetResult(candidate.ResultIndex));
+	return true;
+}
+
+void UMultiplayerSessionsSubsystem::JoinSessionInternal(const FOnlineSessionSearchResult& result)
+{
+	JoinedLanHostAddress.Reset();
+
+	//Found by LAN discovery, there is no backend session to join, travel goes straight to the host
+	//The advert tells whether the host has room, a full one is reported like the backend would, so the next candidate gets its turn
+	FString lanHostAddress;
+	if (FLanSessionDiscovery::GetHostAddress(result, lanHostAddress))
+	{
+		JoiningSessionId = result.GetSessionIdStr();
+		const bool bHostFull = result.Session.NumOpenPublicConnections <= 0;
+		if (!bHostFull)
+		{
+			JoinedLanHostAddress = lanHostAddress;
+		}
+		OnJoinSessionComplete(NAME_GameSession, bHostFull ? EOnJoinSessionCompleteResult::SessionIsFull : EOnJoinSessionCompleteResult::Success);
+		return;
+	}
+
+	JoinSessionCompleteDelegateHandle = OnlineSessionInterface->AddOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegate);
+	JoiningSessionId = result.GetSessionIdStr();
+
+	const FUniqueNetIdPtr localUserId = GetLocalUserId();
+	const bool bJoining = localUserId.IsValid()
+		? OnlineSessionInterface->JoinSession(*localUserId, NAME_GameSession, result)
+		: OnlineSessionInterface->JoinSession(0, NAME_GameSession, result);
+	if (!bJoining)
+	{
+		//No session joined
+		//Remove delegate
+		OnlineSessionInterface->ClearOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegateHandle);
+
+		//Broadcast custom delegate
+		NextJoinCandidate = INDEX_NONE;
+		BroadcastJoinSessionComplete(EOnJoinSessionCompleteResult::UnknownError);
+		FinishOperation();
+	}
+}
+
+void UMultiplayerSessionsSubsystem::DestroySession()
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(UMultiplayerSessionsSubsystem::DestroySession);
+
+	if (!ResolveSessionInterface())
+	{
+		BroadcastDestroySessionComplete(false);
+		return;
+	}
+
+	EnqueueOperation(EMultiplayerSessionState::Destroying, [this]()
+	{
+		StartDestroySession();
+	});
+}
+
+void UMultiplayerSessionsSubsystem::StartDestroySession()
+{
+	//Joined through LAN discovery, there is no backend session, leaving the host is all there is to it
+	if (!JoinedLanHostAddress.IsEmpty() && !OnlineSessionInterface->GetNamedSession(NAME_GameSession))
+	{
+		OnDestroySessionComplete(NAME_GameSession, true);
+		return;
+	}
+
+	DestroySessionCompleteDelegateHandle = OnlineSessionInterface->AddOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegate);
+
+	if (!OnlineSessionInterface->DestroySession(NAME_GameSession))
+	{
+		//Failed to destroy session
+		//Remove delegate
+		OnlineSessionInterface->ClearOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegateHandle);
+		//Whatever session there was, it is not the LAN host we joined anymore
+		JoinedLanHostAddress.Reset();
+
+		//Broadcast custom delegate
+		BroadcastDestroySessionComplete(false);
+		FinishOperation();
+	}
+}
+
+void UMultiplayerSessionsSubsystem::StartSession()
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(UMultiplayerSessionsSubsystem::StartSession);
+
+	if (!ResolveSessionInterface())
+	{
+		return;
+	}
+
+	EnqueueOperation(EMultiplayerSessionState::Starting, [this]()
+	{
+		StartSessionInternal();
+	});
+}
+
+void UMultiplayerSessionsSubsystem::StartSessionInternal()
+{
+	StartSessionCompleteDelegateHandle = OnlineSessionInterface->AddOnStartSessionCompleteDelegate_Handle(StartSessionCompleteDelegate);
+
+	if (!OnlineSessionInterface->StartSession(NAME_GameSession))
+	{
+		//Session didn't start
+		//Remove delegate
+		OnlineSessionInterface->ClearOnStartSessionCompleteDelegate_Handle(StartSessionCompleteDelegateHandle);
+
+		//Broadcast custom delegate
+		BroadcastStartSessionComplete(false);
+		FinishOperation();
+	}
+}
+
+void UMultiplayerSessionsSubsystem::EnqueueOperation(EMultiplayerSessionState state, TFunction<void()>&& start)
+{
+	//A newer request replaces a queued one of the same kind, only the latest parameters matter
+	FQueuedSessionOperation* pQueuedOperation = QueuedOperations.FindByPredicate([state](const FQueuedSessionOperation& operation)
+	{
+		return operation.State == state;
+	});
+	if (pQueuedOperation)
+	{
+		pQueuedOperation->Start = MoveTemp(start);
+		FMultiplayerSessionsTrace::OutputOperation(pQueuedOperation->Id, (uint8)state, ESessionTraceStage::Coalesced, NAME_None, -1, true);
+		return;
+	}
+
+	FQueuedSessionOperation& operation = QueuedOperations.AddDefaulted_GetRef();
+	operation.Id = NextOperationId++;
+	operation.State = state;
+	operation.Start = MoveTemp(start);
+	FMultiplayerSessionsTrace::OutputOperation(operation.Id, (uint8)state, ESessionTraceStage::Queued, NAME_None, -1, true);
+
+	StartNextOperation();
+}
+
+void UMultiplayerSessionsSubsystem::StartNextOperation()
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(UMultiplayerSessionsSubsystem::StartNextOperation);
+
+	if (CurrentState != EMultiplayerSessionState::Idle || QueuedOperations.Num() <= 0)
+	{
+		return;
+	}
+
+	//The backend only runs one search at a time, the next one waits until the detached search completed
+	if (QueuedOperations[0].State == EMultiplayerSessionState::Finding && DetachedSessionSearch.IsValid())
+	{
+		return;
+	}
+
+	FQueuedSessionOperation operation = MoveTemp(QueuedOperations[0]);
+	QueuedOperations.RemoveAt(0);
+
+	CurrentState = operation.State;
+	CurrentOperationId = operation.Id;
+	TraceOperation(CurrentState, ESessionTraceStage::Started, NAME_None, -1, true);
+
+	//Timed from the moment it runs, waiting in the queue doesn't count
+	ESessionLatencyPhase phase;
+	if (GetLatencyPhase(CurrentState, phase))
+	{
+		LatencyStats.BeginPhase(phase);
+	}
+
+	ArmOperationDeadline();
+	operation.Start();
+}
+
+void UMultiplayerSessionsSubsystem::FinishOperation()
+{
+	ESessionLatencyPhase phase;
+	if (GetLatencyPhase(CurrentState, phase))
+	{
+		LatencyStats.EndPhase(phase);
+	}
+
+	CurrentState = EMultiplayerSessionState::Idle;
+	StartNextOperation();
+}
+
+void UMultiplayerSessionsSubsystem::ArmOperationDeadline()
+{
+	const float timeoutSeconds = GetOperationTimeout(CurrentState);
+	OperationDeadline = timeoutSeconds > 0.0f ? FPlatformTime::Seconds() + timeoutSeconds : 0.0;
+
+	//Only ticks while an operation is running
+	if (OperationDeadline > 0.0 && !OperationWatchdogTickerHandle.IsValid())
+	{
+		OperationWatchdogTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::TickOperationWatchdog), 0.25f);
+	}
+}
+
+float UMultiplayerSessionsSubsystem::GetOperationTimeout(EMultiplayerSessionState state) const
+{
+	switch (state)
+	{
+	case EMultiplayerSessionState::Creating: return CreateSessionTimeoutSeconds;
+	case EMultiplayerSessionState::Destroying: return DestroySessionTimeoutSeconds;
+	case EMultiplayerSessionState::Finding: return FindSessionsTimeoutSeconds;
+	case EMultiplayerSessionState::Joining: return JoinSessionTimeoutSeconds;
+	case EMultiplayerSessionState::Starting: return StartSessionTimeoutSeconds;
+	default: return 0.0f;
+	}
+}
+
+bool UMultiplayerSessionsSubsystem::TickOperationWatchdog(float deltaTime)
+{
+	if (DetachedSessionSearch.IsValid() && DetachedSearchDeadline > 0.0 && FPlatformTime::Seconds() >= DetachedSearchDeadline)
+	{
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("Detached search did not complete within %.1f seconds, searching again"), FindSessionsTimeoutSeconds);
+		DropDetachedSearch();
+	}
+
+	if (CurrentState == EMultiplayerSessionState::Idle && !DetachedSessionSearch.IsValid())
 	{
-		OnlineSessionInterface = pSubsystem->GetSessionInterface();
+		OperationWatchdogTickerHandle.Reset();
+		return false;
 	}
+
+	if (CurrentState != EMultiplayerSessionState::Idle && OperationDeadline > 0.0 && FPlatformTime::Seconds() >= OperationDeadline)
+	{
+		TimeOutOperation();
+	}
+	return true;
 }
 
-void UMultiplayerSessionsSubsystem::CreateSession(int32 numPublicConnections, FString matchType)
+void UMultiplayerSessionsSubsystem::TimeOutOperation()
 {
-	if (!OnlineSessionInterface.IsValid())
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(UMultiplayerSessionsSubsystem::TimeOutOperation);
+
+	const EMultiplayerSessionState timedOutState = CurrentState;
+	UE_LOG(LogMultiplayerSessions, Warning, TEXT("%s timed out after %.1f seconds without an answer from the backend"), *UEnum::GetValueAsString(timedOutState), GetOperationTimeout(timedOutState));
+	TraceOperation(timedOutState, ESessionTraceStage::TimedOut, NAME_None, -1, false);
+
+	//A timeout is not a duration worth recording
+	AbortOperationPhase();
+	OperationDeadline = 0.0;
+	MultiplayerOnSessionOperationTimedOut.Broadcast(timedOutState);
+
+	//Clear the delegate handles, so a late answer of the backend doesn't reach us anymore
+	switch (timedOutState)
+	{
+	case EMultiplayerSessionState::Creating:
+		OnlineSessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegateHandle);
+		BroadcastCreateSessionComplete(false);
+		break;
+	case EMultiplayerSessionState::Destroying:
+		OnlineSessionInterface->ClearOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegateHandle);
+		JoinedLanHostAddress.Reset();
+		BroadcastDestroySessionComplete(false);
+		break;
+	case EMultiplayerSessionState::Finding:
+		AbandonRunningSearch(false);
+		break;
+	case EMultiplayerSessionState::Joining:
+		QosProber.CancelProbe();
+		OnlineSessionInterface->ClearOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegateHandle);
+		//A host that doesn't answer counts against it like one that couldn't be reached
+		SessionRanker.RecordJoinResult(JoiningSessionId, EOnJoinSessionCompleteResult::UnknownError);
+		NextJoinCandidate = INDEX_NONE;
+		BroadcastJoinSessionComplete(EOnJoinSessionCompleteResult::UnknownError);
+		break;
+	case EMultiplayerSessionState::Starting:
+		OnlineSessionInterface->ClearOnStartSessionCompleteDelegate_Handle(StartSessionCompleteDelegateHandle);
+		BroadcastStartSessionComplete(false);
+		break;
+	default:
+		break;
+	}
+
+	FinishOperation();
+}
+
+void UMultiplayerSessionsSubsystem::CancelFindSessions()
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(UMultiplayerSessionsSubsystem::CancelFindSessions);
+
+	//Queued searches never reached the backend, dropping them is enough
+	TArray<uint32> cancelledSearchIds;
+	bool bQueuedCallers = false;
+	for (const FQueuedSessionOperation& operation : QueuedOperations)
+	{
+		if (operation.State == EMultiplayerSessionState::Finding)
+		{
+			cancelledSearchIds.Add(operation.Id);
+			bQueuedCallers |= !operation.bSilent;
+		}
+	}
+	QueuedOperations.RemoveAll([](const FQueuedSessionOperation& operation)
+	{
+		return operation.State == EMultiplayerSessionState::Finding;
+	});
+
+	for (uint32 searchId : cancelledSearchIds)
+	{
+		FMultiplayerSessionsTrace::OutputOperation(searchId, (uint8)EMultiplayerSessionState::Finding, ESessionTraceStage::Cancelled, NAME_None, -1, false);
+		SetFindSessionsPromiseValues(searchId, FMultiplayerFindSessionsResult());
+		ResolveSearchPages(searchId, nullptr, true);
+	}
+
+	if (CurrentState != EMultiplayerSessionState::Finding)
 	{
+		if (bQueuedCallers)
+		{
+			BroadcastFindSessionsComplete(TArray<FOnlineSessionSearchResult>(), false, 0);
+		}
 		return;
 	}
 
-	//First, check if there is an existing session and destroy it, avoid making multiple sessions
-	auto pExistingSession = OnlineSessionInterface->GetNamedSession(NAME_GameSession);
-	if (pExistingSession)
+	TraceOperation(EMultiplayerSessionState::Finding, ESessionTraceStage::Cancelled, NAME_None, -1, false);
+	AbortOperationPhase();
+	AbandonRunningSearch(bQueuedCallers);
+	FinishOperation();
+}
+
+void UMultiplayerSessionsSubsystem::AbandonRunningSearch(bool bForceBroadcast)
+{
+	//Clear the delegate first, some backends complete the search from inside the cancel
+	StopStreamingSearch();
+	OnlineSessionInterface->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegateHandle);
+	if (!CancelBackendSearch() && IsSearchInProgress())
 	{
-		bCreateSessionOnDestroy = true;
-		LastNumPublicConnections = numPublicConnections;
-		LastMatchType = matchType;
+		DetachRunningSearch();
+	}
 
-		DestroySession();
+	const bool bSilent = bRefreshingSearchCache;
+	bRefreshingSearchCache = false;
+	if (!bSilent || bForceBroadcast)
+	{
+		BroadcastFindSessionsComplete(TArray<FOnlineSessionSearchResult>(), false, CurrentOperationId);
 	}
+}
 
-	//Add delegate CreateSessionComplete and store the handle (needs to be stored so it can be removed)
-	CreateSessionCompleteDelegateHandle = OnlineSessionInterface->AddOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegate);
+void UMultiplayerSessionsSubsystem::DetachRunningSearch()
+{
+	//OnFindSessionsComplete hears about it again, and sees it is the detached search
+	FindSessionsCompleteDelegateHandle = OnlineSessionInterface->AddOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegate);
+	DetachedSessionSearch = LastSessionSearch;
+	DetachedSearchQuery = LastSearchQuery;
 
-	//Create session
-	LastSessionSettings = MakeShareable(new FOnlineSessionSettings());
-	//If the subsystem is null, it is a LAN match
-	LastSessionSettings->bIsLANMatch = IOnlineSubsystem::Get()->GetSubsystemName() == "NULL" ? true : false;
-	LastSessionSettings->NumPublicConnections = numPublicConnections;
-	//Join an on-going session
-	LastSessionSettings->bAllowJoinInProgress = true;
-	LastSessionSettings->bAllowJoinViaPresence = true;
-	LastSessionSettings->bShouldAdvertise = true;
-	LastSessionSettings->bUsesPresence = true;
-	LastSessionSettings->bUseLobbiesIfAvailable = true;
-	LastSessionSettings->Set(FName("MatchType"), matchType, EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
-	LastSessionSettings->BuildUniqueId = 1;
+	//A backend that never completes it would hold back every later search, the watchdog gives it as long as a search
+	DetachedSearchDeadline = FindSessionsTimeoutSeconds > 0.0f ? FPlatformTime::Seconds() + FindSessionsTimeoutSeconds : 0.0;
+	if (DetachedSearchDeadline > 0.0 && !OperationWatchdogTickerHandle.IsValid())
+	{
+		OperationWatchdogTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::TickOperationWatchdog), 0.25f);
+	}
+}
+
+void UMultiplayerSessionsSubsystem::CompleteDetachedSearch(bool bWasSuccessful)
+{
+	TSharedPtr<FOnlineSessionSearch> sessionSearch = MoveTemp(DetachedSessionSearch);
+	DetachedSessionSearch.Reset();
 
-	const ULocalPlayer* pLocalPlayer = GetWorld()->GetFirstLocalPlayerFromController();
-	if (!OnlineSessionInterface->CreateSession(*pLocalPlayer->GetPreferredUniqueNetId(), NAME_GameSession, *LastSessionSettings))
+	//Nobody waits for the results anymore, they are only good for the cache
+	if (bWasSuccessful && sessionSearch->SearchResults.Num() > 0)
 	{
-		//Session not created
-		//Remove delegate
-		OnlineSessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegateHandle);
+		CachedSessionSearch = sessionSearch;
+		CachedSearchQuery = DetachedSearchQuery;
+		CachedSearchTime = FPlatformTime::Seconds();
+	}
 
-		//Broadcast custom delegate
-		MultiplayerOnCreateSessionComplete.Broadcast(false);
+	//A search held back for it is next
+	StartNextOperation();
+}
+
+void UMultiplayerSessionsSubsystem::DropDetachedSearch()
+{
+	if (OnlineSessionInterface.IsValid())
+	{
+		OnlineSessionInterface->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegateHandle);
 	}
+	DetachedSessionSearch.Reset();
+	StartNextOperation();
 }
 
-void UMultiplayerSessionsSubsystem::FindSessions(int32 maxSearchResults)
+void UMultiplayerSessionsSubsystem::AbortOperationPhase()
 {
-	if (!OnlineSessionInterface.IsValid())
+	ESessionLatencyPhase phase;
+	if (GetLatencyPhase(CurrentState, phase))
+	{
+		LatencyStats.AbortPhase(phase);
+	}
+}
+
+void UMultiplayerSessionsSubsystem::OnPostLoadMap(UWorld* pLoadedWorld)
+{
+	//Every game instance in the process hears about every map load
+	if (!pLoadedWorld || pLoadedWorld->GetGameInstance() != GetGameInstance())
 	{
 		return;
 	}
 
-	FindSessionsCompleteDelegateHandle = OnlineSessionInterface->AddOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegate);
+	LatencyStats.EndPhase(ESessionLatencyPhase::Travel);
 
-	LastSessionSearch = MakeShareable(new FOnlineSessionSearch());
-	LastSessionSearch->MaxSearchResults = maxSearchResults;
-	//If the subsystem is null, it is a LAN match
-	LastSessionSearch->bIsLanQuery = IOnlineSubsystem::Get()->GetSubsystemName() == "NULL" ? true : false;
-	LastSessionSearch->QuerySettings.Set(SEARCH_PRESENCE, true, EOnlineComparisonOp::Equals);
+	//The new world holds its own package now, a preload for another map missed its chance
+	ReleasePreloadedMap();
 
-	const ULocalPlayer* pLocalPlayer = GetWorld()->GetFirstLocalPlayerFromController();
-	if (!OnlineSessionInterface->FindSessions(*pLocalPlayer->GetPreferredUniqueNetId(), LastSessionSearch.ToSharedRef()))
+	//A headless server launched with -HostSession advertises itself as soon as its map is up
+	if (!IsDedicatedServerHost() || !FParse::Param(FCommandLine::Get(), TEXT("HostSession")))
 	{
-		//No sessions found
-		//Remove delegate
-		OnlineSessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(FindSessionsCompleteDelegateHandle);
+		return;
+	}
 
-		//Broadcast custom delegate
-		MultiplayerOnFindSessionsComplete.Broadcast(TArray<FOnlineSessionSearchResult>(), false);
+	if (!ResolveSessionInterface() || OnlineSessionInterface->GetNamedSession(NAME_GameSession) || IsOperationPending(EMultiplayerSessionState::Creating))
+	{
+		return;
 	}
+
+	int32 numPublicConnections = DedicatedServerPublicConnections;
+	FString matchType = DedicatedServerMatchType;
+	FParse::Value(FCommandLine::Get(), TEXT("SessionConnections="), numPublicConnections);
+	FParse::Value(FCommandLine::Get(), TEXT("SessionMatchType="), matchType);
+
+	UE_LOG(LogMultiplayerSessions, Log, TEXT("Hosting dedicated server session: %d connections, match type %s"), numPublicConnections, *matchType);
+
+	//Queued, so the start runs once the create completed
+	CreateSession(numPublicConnections, matchType);
+	StartSession();
 }
 
-void UMultiplayerSessionsSubsystem::JoinsSession(const FOnlineSessionSearchResult& result)
+bool UMultiplayerSessionsSubsystem::IsDedicatedServerHost() const
 {
-	if (!OnlineSessionInterface.IsValid())
+	if (bHostAsDedicatedServer || IsRunningDedicatedServer())
 	{
-		MultiplayerOnJoinSessionComplete.Broadcast(EOnJoinSessionCompleteResult::UnknownError);
-		return;
+		return true;
 	}
 
-	JoinSessionCompleteDelegateHandle = OnlineSessionInterface->AddOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegate);
+	UWorld* pWorld = GetWorld();
+	return pWorld && pWorld->GetNetMode() == NM_DedicatedServer;
+}
+
+void UMultiplayerSessionsSubsystem::OnTravelFailure(UWorld* pWorld, ETravelFailure::Type failureType, const FString& errorString)
+{
+	LatencyStats.AbortPhase(ESessionLatencyPhase::Travel);
+}
+
+void UMultiplayerSessionsSubsystem::OnNetworkFailure(UWorld* pWorld, UNetDriver* pNetDriver, ENetworkFailure::Type failureType, const FString& errorString)
+{
+	LatencyStats.AbortPhase(ESessionLatencyPhase::Travel);
+}
 
-	const ULocalPlayer* pLocalPlayer = GetWorld()->GetFirstLocalPlayerFromController();
-	if (!OnlineSessionInterface->JoinSession(*pLocalPlayer->GetPreferredUniqueNetId(), NAME_GameSession, result))
+bool UMultiplayerSessionsSubsystem::IsOperationPending(EMultiplayerSessionState state) const
+{
+	return CurrentState == state || QueuedOperations.ContainsByPredicate([state](const FQueuedSessionOperation& operation)
 	{
-		//No session joined
-		//Remove delegate
-		OnlineSessionInterface->ClearOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegateHandle);
+		return operation.State == state;
+	});
+}
 
-		//Broadcast custom delegate
-		MultiplayerOnJoinSessionComplete.Broadcast(EOnJoinSessionCompleteResult::UnknownError);
+void UMultiplayerSessionsSubsystem::CancelQueuedOperations()
+{
+	QueuedOperations.Reset();
+
+	//Futures of the running operation still get its result
+	FailPendingFutures(CurrentState);
+}
+
+TFuture<bool> UMultiplayerSessionsSubsystem::CreateSessionAsync(int32 numPublicConnections, FString matchType)
+{
+	if (!ResolveSessionInterface())
+	{
+		return MakeFulfilledPromise<bool>(false).GetFuture();
 	}
+
+	TFuture<bool> future = CreateSessionPromises.Emplace_GetRef().GetFuture();
+	CreateSession(numPublicConnections, MoveTemp(matchType));
+	return future;
 }
 
-void UMultiplayerSessionsSubsystem::DestroySession()
+TFuture<FMultiplayerFindSessionsResult> UMultiplayerSessionsSubsystem::FindSessionsAsync(const FSessionSearchQuery& query)
 {
-	if (!OnlineSessionInterface.IsValid())
+	if (!ResolveSessionInterface())
 	{
-		MultiplayerOnDestroySessionComplete.Broadcast(false);
-		return;
+		return MakeFulfilledPromise<FMultiplayerFindSessionsResult>().GetFuture();
 	}
 
-	DestroySessionCompleteDelegateHandle = OnlineSessionInterface->AddOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegate);
+	TPromise<FMultiplayerFindSessionsResult> promise;
+	TFuture<FMultiplayerFindSessionsResult> future = promise.GetFuture();
+	FindSessionsInternal(query, false, 0, &promise);
+	return future;
+}
 
-	if (!OnlineSessionInterface->DestroySession(NAME_GameSession))
+TFuture<FMultiplayerFindSessionsPageResult> UMultiplayerSessionsSubsystem::FindSessionsPageAsync(const FSessionSearchQuery& query, int32 pageSize, const FSessionSearchCursor& cursor)
+{
+	//Nothing left to hand out, or the search the cursor pages through is gone
+	const TSharedPtr<FOnlineSessionSearch> sessionSearch = cursor.SessionSearch.Pin();
+	if (cursor.bEndReached || !ResolveSessionInterface() || (!sessionSearch.IsValid() && cursor.Offset > 0))
 	{
-		//Failed to destroy session
-		//Remove delegate
-		OnlineSessionInterface->ClearOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegateHandle);
+		FMultiplayerFindSessionsPageResult pageResult;
+		pageResult.NextCursor = cursor;
+		pageResult.NextCursor.bEndReached = true;
+		pageResult.bWasSuccessful = cursor.bEndReached;
+		return MakeFulfilledPromise<FMultiplayerFindSessionsPageResult>(MoveTemp(pageResult)).GetFuture();
+	}
 
-		//Broadcast custom delegate
-		MultiplayerOnDestroySessionComplete.Broadcast(false);
+	FFindSessionsPagePromise pagePromise;
+	pagePromise.Offset = cursor.Offset;
+	pagePromise.PageSize = FMath::Max(pageSize, 1);
+	pagePromise.Query = query;
+	TFuture<FMultiplayerFindSessionsPageResult> future = pagePromise.Promise.GetFuture();
+
+	//First page, one streaming search the later pages are cut from as its results come in
+	if (!sessionSearch.IsValid())
+	{
+		FindSessionsInternal(query, true, 0, nullptr, &pagePromise);
+		return future;
 	}
+
+	//Results the running search added since the last tick are not filtered yet
+	if (sessionSearch == LastSessionSearch)
+	{
+		FilterNewSearchResults();
+	}
+
+	//The search of the cursor is still running and hasn't found enough for this page yet
+	const bool bSearchRunning = CurrentState == EMultiplayerSessionState::Finding && sessionSearch == LastSessionSearch && IsSearchInProgress();
+	if (bSearchRunning && sessionSearch->SearchResults.Num() < FMath::Min(pagePromise.Offset + pagePromise.PageSize, query.MaxSearchResults))
+	{
+		pagePromise.SearchId = CurrentOperationId;
+		FindSessionsPagePromises.Add(MoveTemp(pagePromise));
+		return future;
+	}
+
+	PrepareSearchResults(sessionSearch, query);
+	pagePromise.Promise.SetValue(MakeSessionsPage(sessionSearch, query.MaxSearchResults, pagePromise.Offset, pagePromise.PageSize, !bSearchRunning));
+	return future;
 }
 
-void UMultiplayerSessionsSubsystem::StartSession()
+TFuture<EOnJoinSessionCompleteResult::Type> UMultiplayerSessionsSubsystem::JoinSessionAsync(const FOnlineSessionSearchResult& result)
 {
-	if (!OnlineSessionInterface.IsValid())
+	TFuture<EOnJoinSessionCompleteResult::Type> future = JoinSessionPromises.Emplace_GetRef().GetFuture();
+	JoinsSession(result);
+	return future;
+}
+
+TFuture<EOnJoinSessionCompleteResult::Type> UMultiplayerSessionsSubsystem::JoinBestSessionAsync()
+{
+	TFuture<EOnJoinSessionCompleteResult::Type> future = JoinSessionPromises.Emplace_GetRef().GetFuture();
+	JoinBestSession();
+	return future;
+}
+
+TFuture<bool> UMultiplayerSessionsSubsystem::DestroySessionAsync()
+{
+	TFuture<bool> future = DestroySessionPromises.Emplace_GetRef().GetFuture();
+	DestroySession();
+	return future;
+}
+
+TFuture<bool> UMultiplayerSessionsSubsystem::StartSessionAsync()
+{
+	if (!ResolveSessionInterface())
 	{
-		return;
+		return MakeFulfilledPromise<bool>(false).GetFuture();
 	}
 
-	StartSessionCompleteDelegateHandle = OnlineSessionInterface->AddOnStartSessionCompleteDelegate_Handle(StartSessionCompleteDelegate);
+	TFuture<bool> future = StartSessionPromises.Emplace_GetRef().GetFuture();
+	StartSession();
+	return future;
+}
 
-	if (!OnlineSessionInterface->StartSession(NAME_GameSession))
+template<typename ResultType>
+static void SetPromiseValues(TArray<TPromise<ResultType>>& promises, const ResultType& result)
+{
+	//Continuations run inside SetValue and can ask for new futures, so take the list out first
+	TArray<TPromise<ResultType>> promisesToSet = MoveTemp(promises);
+	for (TPromise<ResultType>& promise : promisesToSet)
 	{
-		//Session didn't start
-		//Remove delegate
-		OnlineSessionInterface->ClearOnStartSessionCompleteDelegate_Handle(StartSessionCompleteDelegateHandle);
+		promise.SetValue(result);
+	}
+}
 
-		//Broadcast custom delegate
-		MultiplayerOnStartSessionComplete.Broadcast(false);
+void UMultiplayerSessionsSubsystem::FailPendingFutures(EMultiplayerSessionState stateToKeep)
+{
+	if (stateToKeep != EMultiplayerSessionState::Creating)
+	{
+		SetPromiseValues(CreateSessionPromises, false);
+	}
+	//Only the running search keeps its futures, queued searches might not run anymore
+	const uint32 searchIdToKeep = stateToKeep == EMultiplayerSessionState::Finding && CurrentState == EMultiplayerSessionState::Finding ? CurrentOperationId : 0;
+	TArray<FFindSessionsPromise> findPromisesToFail;
+	for (FFindSessionsPromise& findPromise : FindSessionsPromises)
+	{
+		if (findPromise.SearchId != searchIdToKeep)
+		{
+			findPromisesToFail.Add(MoveTemp(findPromise));
+		}
+	}
+	FindSessionsPromises.RemoveAll([searchIdToKeep](const FFindSessionsPromise& findPromise)
+	{
+		return findPromise.SearchId != searchIdToKeep;
+	});
+	for (FFindSessionsPromise& findPromise : findPromisesToFail)
+	{
+		findPromise.Promise.SetValue(FMultiplayerFindSessionsResult());
+	}
+	TArray<FFindSessionsPagePromise> pagePromisesToFail;
+	for (FFindSessionsPagePromise& pagePromise : FindSessionsPagePromises)
+	{
+		if (pagePromise.SearchId != searchIdToKeep)
+		{
+			pagePromisesToFail.Add(MoveTemp(pagePromise));
+		}
+	}
+	FindSessionsPagePromises.RemoveAll([searchIdToKeep](const FFindSessionsPagePromise& pagePromise)
+	{
+		return pagePromise.SearchId != searchIdToKeep;
+	});
+	for (FFindSessionsPagePromise& pagePromise : pagePromisesToFail)
+	{
+		FMultiplayerFindSessionsPageResult pageResult;
+		pageResult.NextCursor.bEndReached = true;
+		pagePromise.Promise.SetValue(MoveTemp(pageResult));
+	}
+	if (stateToKeep != EMultiplayerSessionState::Joining)
+	{
+		SetPromiseValues(JoinSessionPromises, EOnJoinSessionCompleteResult::UnknownError);
+	}
+	if (stateToKeep != EMultiplayerSessionState::Destroying)
+	{
+		SetPromiseValues(DestroySessionPromises, false);
+	}
+	if (stateToKeep != EMultiplayerSessionState::Starting)
+	{
+		SetPromiseValues(StartSessionPromises, false);
+	}
+}
+
+void UMultiplayerSessionsSubsystem::TraceOperation(EMultiplayerSessionState kind, ESessionTraceStage stage, FName sessionName, int32 resultCount, bool bWasSuccessful) const
+{
+	//Outside of the operation, e.g. a queued one, there is no id to tell
+	const uint32 operationId = CurrentState == kind ? CurrentOperationId : 0;
+	FMultiplayerSessionsTrace::OutputOperation(operationId, (uint8)kind, stage, sessionName, resultCount, bWasSuccessful);
+}
+
+void UMultiplayerSessionsSubsystem::BroadcastCreateSessionComplete(bool bWasSuccessful)
+{
+	TraceOperation(EMultiplayerSessionState::Creating, ESessionTraceStage::Completed, NAME_GameSession, -1, bWasSuccessful);
+	MultiplayerOnCreateSessionComplete.Broadcast(bWasSuccessful);
+	SetPromiseValues(CreateSessionPromises, bWasSuccessful);
+}
+
+void UMultiplayerSessionsSubsystem::BroadcastFindSessionsComplete(const TArray<FOnlineSessionSearchResult>& sessionResults, bool bWasSuccessful, uint32 searchId)
+{
+	FMultiplayerSessionsTrace::OutputOperation(searchId, (uint8)EMultiplayerSessionState::Finding, ESessionTraceStage::Completed, NAME_None, sessionResults.Num(), bWasSuccessful);
+	MultiplayerOnFindSessionsComplete.Broadcast(sessionResults, bWasSuccessful);
+
+	if (searchId != 0 && FindSessionsPromises.Num() > 0)
+	{
+		FMultiplayerFindSessionsResult findResult;
+		findResult.SessionResults = sessionResults;
+		findResult.bWasSuccessful = bWasSuccessful;
+		SetFindSessionsPromiseValues(searchId, findResult);
+	}
+
+	//Successful results were prepared from the search the index is on, pages are cut from the whole of it
+	if (searchId != 0 && FindSessionsPagePromises.Num() > 0)
+	{
+		ResolveSearchPages(searchId, bWasSuccessful ? SearchIndex.GetSessionSearch() : nullptr, true);
+	}
+}
+
+void UMultiplayerSessionsSubsystem::SetFindSessionsPromiseValues(uint32 searchId, const FMultiplayerFindSessionsResult& result)
+{
+	//Continuations run inside SetValue and can ask for new futures, so take ours out first
+	TArray<FFindSessionsPromise> promisesToSet;
+	for (FFindSessionsPromise& findPromise : FindSessionsPromises)
+	{
+		if (findPromise.SearchId == searchId)
+		{
+			promisesToSet.Add(MoveTemp(findPromise));
+		}
+	}
+	FindSessionsPromises.RemoveAll([searchId](const FFindSessionsPromise& findPromise)
+	{
+		return findPromise.SearchId == searchId;
+	});
+
+	for (FFindSessionsPromise& findPromise : promisesToSet)
+	{
+		findPromise.Promise.SetValue(result);
 	}
 }
 
+void UMultiplayerSessionsSubsystem::ResolveSearchPages(uint32 searchId, const TSharedPtr<FOnlineSessionSearch>& sessionSearch, bool bSearchDone)
+{
+	const int32 numResults = sessionSearch.IsValid() ? sessionSearch->SearchResults.Num() : 0;
+	auto isPageReady = [searchId, numResults, bSearchDone](const FFindSessionsPagePromise& pagePromise)
+	{
+		return pagePromise.SearchId == searchId && (bSearchDone || numResults >= FMath::Min(pagePromise.Offset + pagePromise.PageSize, pagePromise.Query.MaxSearchResults));
+	};
+
+	//Continuations run inside SetValue and can ask for the next page, so take ours out first
+	TArray<FFindSessionsPagePromise> pagesToResolve;
+	for (FFindSessionsPagePromise& pagePromise : FindSessionsPagePromises)
+	{
+		if (isPageReady(pagePromise))
+		{
+			pagesToResolve.Add(MoveTemp(pagePromise));
+		}
+	}
+	FindSessionsPagePromises.RemoveAll(isPageReady);
+
+	for (FFindSessionsPagePromise& pagePromise : pagesToResolve)
+	{
+		//Whoever gets the page expects GetBestSession to cover it
+		if (sessionSearch.IsValid())
+		{
+			PrepareSearchResults(sessionSearch, pagePromise.Query);
+		}
+		pagePromise.Promise.SetValue(MakeSessionsPage(sessionSearch, pagePromise.Query.MaxSearchResults, pagePromise.Offset, pagePromise.PageSize, bSearchDone));
+	}
+}
+
+void UMultiplayerSessionsSubsystem::BroadcastJoinSessionComplete(EOnJoinSessionCompleteResult::Type result)
+{
+	TraceOperation(EMultiplayerSessionState::Joining, ESessionTraceStage::Completed, NAME_GameSession, -1, result == EOnJoinSessionCompleteResult::Success);
+	MultiplayerOnJoinSessionComplete.Broadcast(result);
+	SetPromiseValues(JoinSessionPromises, result);
+}
+
+void UMultiplayerSessionsSubsystem::BroadcastDestroySessionComplete(bool bWasSuccessful)
+{
+	TraceOperation(EMultiplayerSessionState::Destroying, ESessionTraceStage::Completed, NAME_GameSession, -1, bWasSuccessful);
+	MultiplayerOnDestroySessionComplete.Broadcast(bWasSuccessful);
+	SetPromiseValues(DestroySessionPromises, bWasSuccessful);
+}
+
+void UMultiplayerSessionsSubsystem::BroadcastStartSessionComplete(bool bWasSuccessful)
+{
+	TraceOperation(EMultiplayerSessionState::Starting, ESessionTraceStage::Completed, NAME_GameSession, -1, bWasSuccessful);
+	MultiplayerOnStartSessionComplete.Broadcast(bWasSuccessful);
+	SetPromiseValues(StartSessionPromises, bWasSuccessful);
+}
+
 void UMultiplayerSessionsSubsystem::OnCreateSessionComplete(FName sessionName, bool bWasSuccessful)
 {
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(UMultiplayerSessionsSubsystem::OnCreateSessionComplete);
+	TraceOperation(EMultiplayerSessionState::Creating, ESessionTraceStage::Callback, sessionName, -1, bWasSuccessful);
+
 	if (OnlineSessionInterface)
 	{
 		//Session created
@@ -165,12 +1870,32 @@ void UMultiplayerSessionsSubsystem::OnCreateSessionComplete(FName sessionName, b
 		OnlineSessionInterface->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegateHandle);
 	}
 
+	//LAN clients with fast discovery ask us directly, the NULL beacon doesn't answer them
+	if (bWasSuccessful && ShouldUseLanDiscovery())
+	{
+		GetLanDiscovery().StartAdvertising(FLanSessionDiscovery::FOnFillAdvert::CreateUObject(this, &ThisClass::FillLanAdvert));
+	}
+
+	//Clients probe us before they pick a session to join
+	if (bWasSuccessful && bQosResponder)
+	{
+		if (!QosResponder.IsValid())
+		{
+			QosResponder = MakeUnique<FSessionQosResponder>(QosPort);
+		}
+		QosResponder->StartResponding();
+	}
+
 	//Broadcast custom delegate
-	MultiplayerOnCreateSessionComplete.Broadcast(bWasSuccessful);
+	BroadcastCreateSessionComplete(bWasSuccessful);
+	FinishOperation();
 }
 
 void UMultiplayerSessionsSubsystem::OnFindSessionsComplete(bool bWasSuccessful)
 {
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(UMultiplayerSessionsSubsystem::OnFindSessionsComplete);
+	TraceOperation(EMultiplayerSessionState::Finding, ESessionTraceStage::Callback, NAME_None, LastSessionSearch.IsValid() ? LastSessionSearch->SearchResults.Num() : 0, bWasSuccessful);
+
 	if (OnlineSessionInterface)
 	{
 		//Sessions found
@@ -178,19 +1903,56 @@ void UMultiplayerSessionsSubsystem::OnFindSessionsComplete(bool bWasSuccessful)
 		OnlineSessionInterface->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegateHandle);
 	}
 
-	if (LastSessionSearch->SearchResults.Num() <= 0)
+	//The operation this search belonged to is long over
+	if (DetachedSessionSearch.IsValid())
 	{
-		//If the search results array is empty
-		MultiplayerOnFindSessionsComplete.Broadcast(TArray<FOnlineSessionSearchResult>(), false);
+		CompleteDetachedSearch(bWasSuccessful);
 		return;
 	}
 
-	//Broadcast custom delegate
-	MultiplayerOnFindSessionsComplete.Broadcast(LastSessionSearch->SearchResults, bWasSuccessful);
+	if (bStreamingSearch)
+	{
+		//Flush the last replies to the batch listeners before the final broadcast
+		StopStreamingSearch();
+		BroadcastStreamedResults();
+	}
+
+	FilterNewSearchResults();
+
+	if (bWasSuccessful && LastSessionSearch->SearchResults.Num() > 0)
+	{
+		CachedSessionSearch = LastSessionSearch;
+		CachedSearchQuery = LastSearchQuery;
+		CachedSearchTime = FPlatformTime::Seconds();
+	}
+
+	//Index once here, so listeners can query by reference instead of walking the results
+	PrepareSearchResults(LastSessionSearch, LastSearchQuery);
+
+	if (bRefreshingSearchCache)
+	{
+		//Background refresh, the caller already got the cached results
+		bRefreshingSearchCache = false;
+	}
+	else if (LastSessionSearch->SearchResults.Num() <= 0)
+	{
+		//If the search results array is empty
+		BroadcastFindSessionsComplete(TArray<FOnlineSessionSearchResult>(), false, CurrentOperationId);
+	}
+	else
+	{
+		//Broadcast custom delegate
+		BroadcastFindSessionsComplete(LastSessionSearch->SearchResults, bWasSuccessful, CurrentOperationId);
+	}
+
+	FinishOperation();
 }
 
 void UMultiplayerSessionsSubsystem::OnJoinSessionComplete(FName sessionName, EOnJoinSessionCompleteResult::Type result)
 {
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(UMultiplayerSessionsSubsystem::OnJoinSessionComplete);
+	TraceOperation(EMultiplayerSessionState::Joining, ESessionTraceStage::Callback, sessionName, -1, result == EOnJoinSessionCompleteResult::Success);
+
 	if (OnlineSessionInterface)
 	{
 		//Session joined
@@ -198,12 +1960,33 @@ void UMultiplayerSessionsSubsystem::OnJoinSessionComplete(FName sessionName, EOn
 		OnlineSessionInterface->ClearOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegateHandle);
 	}
 
+	//Hosts that keep failing end up further down the ranking
+	SessionRanker.RecordJoinResult(JoiningSessionId, result);
+
+	if (result == EOnJoinSessionCompleteResult::SessionIsFull || result == EOnJoinSessionCompleteResult::SessionDoesNotExist)
+	{
+		//The cached results are out of date, the next search has to go to the backend
+		InvalidateSearchCache();
+
+		//Try the next best session from the last search instead of making the player search again
+		if (TryJoinNextCandidate())
+		{
+			return;
+		}
+	}
+
+	NextJoinCandidate = INDEX_NONE;
+
 	//Broadcast custom delegate
-	MultiplayerOnJoinSessionComplete.Broadcast(result);
+	BroadcastJoinSessionComplete(result);
+	FinishOperation();
 }
 
 void UMultiplayerSessionsSubsystem::OnDestroySessionComplete(FName sessionName, bool bWasSuccessful)
 {
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(UMultiplayerSessionsSubsystem::OnDestroySessionComplete);
+	TraceOperation(EMultiplayerSessionState::Destroying, ESessionTraceStage::Callback, sessionName, -1, bWasSuccessful);
+
 	if (OnlineSessionInterface)
 	{
 		//Session destroyed
@@ -211,19 +1994,26 @@ void UMultiplayerSessionsSubsystem::OnDestroySessionComplete(FName sessionName,
 		OnlineSessionInterface->ClearOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegateHandle);
 	}
 
-	if (bWasSuccessful && bCreateSessionOnDestroy)
+	JoinedLanHostAddress.Reset();
+	if (LanDiscovery.IsValid())
+	{
+		LanDiscovery->StopAdvertising();
+	}
+	if (QosResponder.IsValid())
 	{
-		//Creating a new session after destroying one
-		//When trying to create a session but one already existed it will destroy it first and then create a new one
-		bCreateSessionOnDestroy = false;
-		CreateSession(LastNumPublicConnections, LastMatchType);
+		QosResponder->StopResponding();
 	}
 
-	MultiplayerOnDestroySessionComplete.Broadcast(bWasSuccessful);
+	//A create waiting for this destroy is next in the queue
+	BroadcastDestroySessionComplete(bWasSuccessful);
+	FinishOperation();
 }
 
 void UMultiplayerSessionsSubsystem::OnStartSessionComplete(FName sessionName, bool bWasSuccessful)
 {
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(UMultiplayerSessionsSubsystem::OnStartSessionComplete);
+	TraceOperation(EMultiplayerSessionState::Starting, ESessionTraceStage::Callback, sessionName, -1, bWasSuccessful);
+
 	if (OnlineSessionInterface)
 	{
 		//Session started
@@ -231,5 +2021,6 @@ void UMultiplayerSessionsSubsystem::OnStartSessionComplete(FName sessionName, bo
 		OnlineSessionInterface->ClearOnStartSessionCompleteDelegate_Handle(StartSessionCompleteDelegateHandle);
 	}
 
-	MultiplayerOnStartSessionComplete.Broadcast(bWasSuccessful);
+	BroadcastStartSessionComplete(bWasSuccessful);
+	FinishOperation();
 }
@@ -0,0 +1,37 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "MultiplayerSessionsTrace.h"
+#include "HAL/PlatformTime.h"
+
+UE_TRACE_CHANNEL_DEFINE(MultiplayerSessionsChannel);
+
+UE_TRACE_EVENT_BEGIN(MultiplayerSessions, Operation)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, OperationId)
+	UE_TRACE_EVENT_FIELD(uint8, Kind)
+	UE_TRACE_EVENT_FIELD(uint8, Stage)
+	UE_TRACE_EVENT_FIELD(int32, ResultCount)
+	UE_TRACE_EVENT_FIELD(bool, Success)
+	UE_TRACE_EVENT_FIELD(UE::Trace::WideString, SessionName)
+UE_TRACE_EVENT_END()
+
+void FMultiplayerSessionsTrace::OutputOperation(uint32 operationId, uint8 operationKind, ESessionTraceStage stage, FName sessionName, int32 resultCount, bool bWasSuccessful)
+{
+#if UE_TRACE_ENABLED
+	if (!UE_TRACE_CHANNELEXPR_IS_ENABLED(MultiplayerSessionsChannel))
+	{
+		return;
+	}
+
+	const FString sessionNameString = sessionName.IsNone() ? FString() : sessionName.ToString();
+	UE_TRACE_LOG(MultiplayerSessions, Operation, MultiplayerSessionsChannel)
+		<< Operation.Cycle(FPlatformTime::Cycles64())
+		<< Operation.OperationId(operationId)
+		<< Operation.Kind(operationKind)
+		<< Operation.Stage((uint8)stage)
+		<< Operation.ResultCount(resultCount)
+		<< Operation.Success(bWasSuccessful)
+		<< Operation.SessionName(*sessionNameString, sessionNameString.Len());
+#endif
+}
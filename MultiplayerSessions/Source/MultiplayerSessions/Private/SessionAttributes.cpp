@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SessionAttributes.h"
+
+static constexpr uint32 MatchTypeMask = 0x00FFFFFF;
+
+static TArray<FString> MatchTypeNames = { TEXT("FreeForAll"), TEXT("TeamDeathmatch"), TEXT("CaptureTheFlag") };
+
+void FSessionAttributes::SetMatchTypeNames(const TArray<FString>& matchTypeNames)
+{
+	MatchTypeNames = matchTypeNames;
+}
+
+const TArray<FString>& FSessionAttributes::GetMatchTypeNames()
+{
+	return MatchTypeNames;
+}
+
+bool FSessionAttributes::Make(const FString& matchType, FSessionAttributes& outAttributes)
+{
+	outAttributes = FSessionAttributes();
+	outAttributes.MatchType = FindMatchType(matchType);
+	return outAttributes.MatchType != INDEX_NONE;
+}
+
+void FSessionAttributes::WriteTo(FOnlineSessionSettings& settings) const
+{
+	settings.Set(SESSION_ATTRIBUTE_MATCHTYPE, Pack(), EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
+}
+
+bool FSessionAttributes::Read(const FOnlineSessionSettings& settings, FSessionAttributes& outAttributes)
+{
+	const FOnlineSessionSetting* pSetting = settings.Settings.Find(SESSION_ATTRIBUTE_MATCHTYPE);
+	if (!pSetting || pSetting->Data.GetType() != EOnlineKeyValuePairDataType::Int32)
+	{
+		return false;
+	}
+
+	int32 packedValue = 0;
+	pSetting->Data.GetValue(packedValue);
+	outAttributes = Unpack(packedValue);
+	return outAttributes.Version == SchemaVersion;
+}
+
+const TCHAR* FSessionAttributes::GetMatchTypeName() const
+{
+	return MatchTypeNames.IsValidIndex(MatchType) ? *MatchTypeNames[MatchType] : nullptr;
+}
+
+int32 FSessionAttributes::Pack() const
+{
+	return (int32)(((uint32)Version << 24) | ((uint32)MatchType & MatchTypeMask));
+}
+
+FSessionAttributes FSessionAttributes::Unpack(int32 packedValue)
+{
+	FSessionAttributes attributes;
+	attributes.Version = (uint8)((uint32)packedValue >> 24);
+	const uint32 matchType = (uint32)packedValue & MatchTypeMask;
+	attributes.MatchType = matchType == MatchTypeMask ? INDEX_NONE : (int32)matchType;
+	return attributes;
+}
+
+int32 FSessionAttributes::FindMatchType(const FString& matchType)
+{
+	return MatchTypeNames.IndexOfByPredicate([&matchType](const FString& matchTypeName)
+	{
+		return matchType.Equals(matchTypeName, ESearchCase::CaseSensitive);
+	});
+}
+
+int32 FSessionAttributes::PackMatchType(const FString& matchType)
+{
+	FSessionAttributes attributes;
+	return Make(matchType, attributes) ? attributes.Pack() : UnknownPackedMatchType;
+}
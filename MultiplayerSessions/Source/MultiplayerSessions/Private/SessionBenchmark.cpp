@@ -0,0 +1,393 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SessionBenchmark.h"
+#include "MultiplayerSessions.h"
+#include "MultiplayerSessionsSubsystem.h"
+#include "MockOnlineSession.h"
+#include "SessionSearchIndex.h"
+#include "SessionRanking.h"
+#include "SessionAttributes.h"
+#include "SessionQosProbe.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Containers/Ticker.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonSerializer.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/App.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+
+static const TCHAR* BenchmarkMatchType = TEXT("FreeForAll");
+
+/*
+* Ticks the core ticker until the future is ready, the fake backend completes its operations from there
+*/
+template<typename ResultType>
+static bool WaitForFuture(const TFuture<ResultType>& future, float timeoutSeconds)
+{
+	const double deadline = FPlatformTime::Seconds() + timeoutSeconds;
+	while (!future.IsReady())
+	{
+		if (FPlatformTime::Seconds() > deadline)
+		{
+			return false;
+		}
+
+		FTSTicker::GetCoreTicker().Tick(0.0f);
+	}
+
+	return true;
+}
+
+static FMockOnlineSessionConfig MakeBenchmarkConfig(int32 numSearchResults, int32 randomSeed)
+{
+	//No latency, the ticker gets pumped in a loop and should only measure our own work
+	FMockOnlineSessionConfig config;
+	config.LatencySeconds = 0.0f;
+	config.NumSearchResults = numSearchResults;
+	config.RandomSeed = randomSeed;
+	config.MatchTypes = { BenchmarkMatchType, TEXT("TeamDeathmatch"), TEXT("CaptureTheFlag") };
+	return config;
+}
+
+static FSessionSearchQuery MakeBenchmarkQuery(int32 maxSearchResults)
+{
+	FSessionSearchQuery query;
+	query.MaxSearchResults = maxSearchResults;
+	query.MatchType = BenchmarkMatchType;
+	return query;
+}
+
+static void RunCreateDestroyChurn(UMultiplayerSessionsSubsystem& subsystem, FMockOnlineSession& mockSession, const FSessionBenchmarkSettings& settings, TArray<FSessionBenchmarkResult>& outResults)
+{
+	FSessionBenchmarkResult& createResult = outResults.AddDefaulted_GetRef();
+	createResult.Name = TEXT("CreateSession");
+	FSessionBenchmarkResult& destroyResult = outResults.AddDefaulted_GetRef();
+	destroyResult.Name = TEXT("DestroySession");
+
+	mockSession.SetConfig(MakeBenchmarkConfig(0, 0));
+
+	for (int32 iteration = 0; iteration < settings.Iterations; ++iteration)
+	{
+		double startTime = FPlatformTime::Seconds();
+		TFuture<bool> created = subsystem.CreateSessionAsync(4, BenchmarkMatchType);
+		if (!WaitForFuture(created, settings.OperationTimeoutSeconds) || !created.Get())
+		{
+			++createResult.NumFailures;
+			continue;
+		}
+		createResult.Timings.Add(FPlatformTime::Seconds() - startTime);
+
+		startTime = FPlatformTime::Seconds();
+		TFuture<bool> destroyed = subsystem.DestroySessionAsync();
+		if (!WaitForFuture(destroyed, settings.OperationTimeoutSeconds) || !destroyed.Get())
+		{
+			++destroyResult.NumFailures;
+			continue;
+		}
+		destroyResult.Timings.Add(FPlatformTime::Seconds() - startTime);
+	}
+}
+
+static void RunFind(UMultiplayerSessionsSubsystem& subsystem, FMockOnlineSession& mockSession, const FSessionBenchmarkSettings& settings, int32 numResults, TArray<FSessionBenchmarkResult>& outResults)
+{
+	FSessionBenchmarkResult& findResult = outResults.AddDefaulted_GetRef();
+	findResult.Name = FString::Printf(TEXT("FindSessions_%d"), numResults);
+
+	mockSession.SetConfig(MakeBenchmarkConfig(numResults, 0));
+	const FSessionSearchQuery query = MakeBenchmarkQuery(numResults);
+
+	for (int32 iteration = 0; iteration < settings.Iterations; ++iteration)
+	{
+		//Every run has to go to the backend, a cache hit measures nothing
+		subsystem.InvalidateSearchCache();
+
+		//Includes filtering, indexing and ranking, everything UMenu waits for before it can join
+		const double startTime = FPlatformTime::Seconds();
+		TFuture<FMultiplayerFindSessionsResult> found = subsystem.FindSessionsAsync(query);
+		if (!WaitForFuture(found, settings.OperationTimeoutSeconds) || !found.Get().bWasSuccessful)
+		{
+			++findResult.NumFailures;
+			continue;
+		}
+		findResult.Timings.Add(FPlatformTime::Seconds() - startTime);
+	}
+}
+
+static void RunIndexAndRank(FMockOnlineSession& mockSession, const FSessionBenchmarkSettings& settings, TArray<FSessionBenchmarkResult>& outResults)
+{
+	FSessionBenchmarkResult& rankResult = outResults.AddDefaulted_GetRef();
+	rankResult.Name = FString::Printf(TEXT("IndexAndRank_%d"), settings.RankingResultCount);
+
+	mockSession.SetConfig(MakeBenchmarkConfig(settings.RankingResultCount, 0));
+
+	TSharedPtr<FOnlineSessionSearch> sessionSearch = MakeShared<FOnlineSessionSearch>();
+	sessionSearch->SearchResults.Reserve(settings.RankingResultCount);
+	for (int32 resultIndex = 0; resultIndex < settings.RankingResultCount; ++resultIndex)
+	{
+		sessionSearch->SearchResults.Add(mockSession.MakeSearchResult(resultIndex));
+	}
+
+	const TArray<FName> indexedKeys{ SESSION_ATTRIBUTE_MATCHTYPE };
+	const FVariantData matchTypeIndexValue = FSessionAttributes::GetMatchTypeIndexValue(BenchmarkMatchType);
+	FSessionSearchIndex searchIndex;
+	FSessionRanker ranker;
+	TArray<FRankedSession> rankedSessions;
+
+	for (int32 iteration = 0; iteration < settings.Iterations; ++iteration)
+	{
+		//Same steps the subsystem takes before it broadcasts the results
+		const double startTime = FPlatformTime::Seconds();
+		searchIndex.Reset(sessionSearch, indexedKeys);
+		searchIndex.Update();
+		ranker.RankTopK(sessionSearch->SearchResults, searchIndex.FindResults(SESSION_ATTRIBUTE_MATCHTYPE, matchTypeIndexValue), 16, rankedSessions);
+		rankResult.Timings.Add(FPlatformTime::Seconds() - startTime);
+	}
+}
+
+static void RunMenuPage(UMultiplayerSessionsSubsystem& subsystem, FMockOnlineSession& mockSession, const FSessionBenchmarkSettings& settings, TArray<FSessionBenchmarkResult>& outResults)
+{
+	FSessionBenchmarkResult& pageResult = outResults.AddDefaulted_GetRef();
+	pageResult.Name = FString::Printf(TEXT("MenuPage_%d"), settings.RankingResultCount);
+
+	mockSession.SetConfig(MakeBenchmarkConfig(settings.RankingResultCount, 0));
+
+	//Same query UMenu pages with, the menu usually cuts its pages from a prefetched search
+	const FSessionSearchQuery query = MakeBenchmarkQuery(settings.MenuPageSize * settings.MenuMaxPages);
+	subsystem.InvalidateSearchCache();
+	TFuture<FMultiplayerFindSessionsResult> prefetched = subsystem.FindSessionsAsync(query);
+	if (!WaitForFuture(prefetched, settings.OperationTimeoutSeconds) || !prefetched.Get().bWasSuccessful)
+	{
+		++pageResult.NumFailures;
+		return;
+	}
+
+	for (int32 iteration = 0; iteration < settings.Iterations; ++iteration)
+	{
+		//Filtering, ranking and cutting the first page, until UMenu::OnFindSessionsPage can pick the session to join
+		const double startTime = FPlatformTime::Seconds();
+		TFuture<FMultiplayerFindSessionsPageResult> page = subsystem.FindSessionsPageAsync(query, settings.MenuPageSize);
+		if (!WaitForFuture(page, settings.OperationTimeoutSeconds) || !page.Get().bWasSuccessful || !subsystem.GetBestSession())
+		{
+			++pageResult.NumFailures;
+			continue;
+		}
+		pageResult.Timings.Add(FPlatformTime::Seconds() - startTime);
+	}
+}
+
+static void RunJoinFailover(UMultiplayerSessionsSubsystem& subsystem, FMockOnlineSession& mockSession, const FSessionBenchmarkSettings& settings, TArray<FSessionBenchmarkResult>& outResults)
+{
+	FSessionBenchmarkResult& joinResult = outResults.AddDefaulted_GetRef();
+	joinResult.Name = TEXT("JoinBestSessionFailover");
+
+	const FSessionSearchQuery query = MakeBenchmarkQuery(100);
+
+	for (int32 iteration = 0; iteration < settings.Iterations; ++iteration)
+	{
+		//A different seed per run, so the failures land on different attempts
+		FMockOnlineSessionConfig config = MakeBenchmarkConfig(100, iteration);
+		mockSession.SetConfig(config);
+
+		subsystem.InvalidateSearchCache();
+		TFuture<FMultiplayerFindSessionsResult> found = subsystem.FindSessionsAsync(query);
+		if (!WaitForFuture(found, settings.OperationTimeoutSeconds) || !found.Get().bWasSuccessful)
+		{
+			++joinResult.NumFailures;
+			continue;
+		}
+
+		//Only the joins fail, the attempts after a failure are what this measures
+		config.FailureRate = settings.JoinFailureRate;
+		config.JoinFailureResult = EOnJoinSessionCompleteResult::SessionIsFull;
+		mockSession.SetConfig(config);
+
+		const double startTime = FPlatformTime::Seconds();
+		TFuture<EOnJoinSessionCompleteResult::Type> joined = subsystem.JoinBestSessionAsync();
+		const bool bCompleted = WaitForFuture(joined, settings.OperationTimeoutSeconds);
+		if (bCompleted && joined.Get() == EOnJoinSessionCompleteResult::Success)
+		{
+			joinResult.Timings.Add(FPlatformTime::Seconds() - startTime);
+		}
+		else if (!bCompleted || joined.Get() != config.JoinFailureResult)
+		{
+			//Every attempt rolling a failure is down to the dice, anything else is the subsystem
+			++joinResult.NumFailures;
+		}
+
+		config.FailureRate = 0.0f;
+		mockSession.SetConfig(config);
+		if (bCompleted && mockSession.GetNamedSession(NAME_GameSession))
+		{
+			TFuture<bool> destroyed = subsystem.DestroySessionAsync();
+			WaitForFuture(destroyed, settings.OperationTimeoutSeconds);
+		}
+	}
+}
+
+static void RunQosProbe(const FSessionBenchmarkSettings& settings, TArray<FSessionBenchmarkResult>& outResults)
+{
+	FSessionBenchmarkResult& probeResult = outResults.AddDefaulted_GetRef();
+	probeResult.Name = TEXT("QosProbe");
+
+	FSessionQosResponder responder(0);
+	if (!responder.StartResponding())
+	{
+		++probeResult.NumFailures;
+		return;
+	}
+
+	TArray<FSessionQosTarget> targets;
+	for (int32 targetIndex = 0; targetIndex < settings.QosProbeTargetCount; ++targetIndex)
+	{
+		FSessionQosTarget& target = targets.AddDefaulted_GetRef();
+		target.SessionId = FString::Printf(TEXT("QosBenchmark%d"), targetIndex);
+		target.Address = FString::Printf(TEXT("127.0.0.1:%d"), responder.GetPort());
+	}
+
+	FSessionQosProbeSettings probeSettings;
+	probeSettings.IntervalSeconds = 0.0f;
+
+	FSessionQosProber prober;
+	for (int32 iteration = 0; iteration < settings.Iterations; ++iteration)
+	{
+		bool bCompleted = false;
+		bool bAllReachable = false;
+		const double startTime = FPlatformTime::Seconds();
+		prober.StartProbe(targets, probeSettings, FSessionQosProber::FOnProbeComplete::CreateLambda([&bCompleted, &bAllReachable](const TArray<FSessionQosMeasurement>& measurements)
+		{
+			bCompleted = true;
+			bAllReachable = !measurements.ContainsByPredicate([](const FSessionQosMeasurement& measurement)
+			{
+				return !measurement.IsReachable();
+			});
+		}));
+
+		//The result comes back as a game thread task, not through the ticker
+		const double deadline = startTime + settings.OperationTimeoutSeconds;
+		while (!bCompleted && FPlatformTime::Seconds() < deadline)
+		{
+			FTaskGraphInterface::Get().ProcessThreadUntilIdle(ENamedThreads::GameThread);
+		}
+
+		if (bCompleted && bAllReachable)
+		{
+			probeResult.Timings.Add(FPlatformTime::Seconds() - startTime);
+		}
+		else
+		{
+			prober.CancelProbe();
+			++probeResult.NumFailures;
+		}
+	}
+
+	responder.StopResponding();
+}
+
+TArray<FSessionBenchmarkResult> FSessionBenchmark::Run(UMultiplayerSessionsSubsystem& subsystem, const FSessionBenchmarkSettings& settings)
+{
+	TArray<FSessionBenchmarkResult> results;
+
+	//Point the subsystem at a fake backend for the duration of the run
+	const bool bWasPrefetching = subsystem.IsPrefetchingSearch();
+	subsystem.StopSearchPrefetch();
+	IOnlineSessionPtr previousInterface = subsystem.IsSessionInterfaceOverridden() ? subsystem.GetSessionInterface() : nullptr;
+
+	TSharedRef<FMockOnlineSession, ESPMode::ThreadSafe> mockSession = MakeShared<FMockOnlineSession, ESPMode::ThreadSafe>(MakeBenchmarkConfig(0, 0));
+	subsystem.SetSessionInterfaceOverride(mockSession);
+
+	RunCreateDestroyChurn(subsystem, *mockSession, settings, results);
+	for (int32 numResults : settings.FindResultCounts)
+	{
+		RunFind(subsystem, *mockSession, settings, numResults, results);
+	}
+	RunIndexAndRank(*mockSession, settings, results);
+	RunMenuPage(subsystem, *mockSession, settings, results);
+	RunJoinFailover(subsystem, *mockSession, settings, results);
+	RunQosProbe(settings, results);
+
+	subsystem.SetSessionInterfaceOverride(previousInterface);
+	if (bWasPrefetching)
+	{
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("Session benchmark stopped the search prefetch, start it again if it is still needed"));
+	}
+
+	return results;
+}
+
+FString FSessionBenchmark::ToJson(const TArray<FSessionBenchmarkResult>& results)
+{
+	TArray<TSharedPtr<FJsonValue>> benchmarkValues;
+	for (const FSessionBenchmarkResult& result : results)
+	{
+		const FSessionLatencyHistogram& timings = result.Timings;
+
+		TSharedRef<FJsonObject> benchmarkObject = MakeShared<FJsonObject>();
+		benchmarkObject->SetStringField(TEXT("Name"), result.Name);
+		benchmarkObject->SetNumberField(TEXT("Samples"), timings.Num());
+		benchmarkObject->SetNumberField(TEXT("Failures"), result.NumFailures);
+		benchmarkObject->SetNumberField(TEXT("MeanMs"), timings.GetMeanSeconds() * 1000.0);
+		benchmarkObject->SetNumberField(TEXT("MinMs"), timings.GetMinSeconds() * 1000.0);
+		benchmarkObject->SetNumberField(TEXT("P50Ms"), timings.GetPercentileSeconds(50.0f) * 1000.0);
+		benchmarkObject->SetNumberField(TEXT("P99Ms"), timings.GetPercentileSeconds(99.0f) * 1000.0);
+		benchmarkObject->SetNumberField(TEXT("MaxMs"), timings.GetMaxSeconds() * 1000.0);
+		benchmarkValues.Add(MakeShared<FJsonValueObject>(benchmarkObject));
+	}
+
+	TSharedRef<FJsonObject> rootObject = MakeShared<FJsonObject>();
+	rootObject->SetStringField(TEXT("Platform"), FPlatformProperties::IniPlatformName());
+	rootObject->SetStringField(TEXT("Configuration"), LexToString(FApp::GetBuildConfiguration()));
+	rootObject->SetArrayField(TEXT("Benchmarks"), benchmarkValues);
+
+	FString json;
+	TSharedRef<TJsonWriter<>> writer = TJsonWriterFactory<>::Create(&json);
+	FJsonSerializer::Serialize(rootObject, writer);
+	return json;
+}
+
+FString FSessionBenchmark::GetDefaultJsonPath()
+{
+	return FPaths::ProjectSavedDir() / TEXT("Benchmarks/MultiplayerSessions.json");
+}
+
+static void RunBenchmarkCommand(const TArray<FString>& args, UWorld* pWorld)
+{
+	UGameInstance* pGame = pWorld ? pWorld->GetGameInstance() : nullptr;
+	UMultiplayerSessionsSubsystem* pSubsystem = pGame ? pGame->GetSubsystem<UMultiplayerSessionsSubsystem>() : nullptr;
+	if (!pSubsystem)
+	{
+		UE_LOG(LogMultiplayerSessions, Error, TEXT("Session benchmark needs a game instance with the MultiplayerSessionsSubsystem"));
+		return;
+	}
+
+	FSessionBenchmarkSettings settings;
+	FString filePath = FSessionBenchmark::GetDefaultJsonPath();
+	bool bQuit = false;
+	for (const FString& arg : args)
+	{
+		FParse::Value(*arg, TEXT("Iterations="), settings.Iterations);
+		FParse::Value(*arg, TEXT("File="), filePath);
+		bQuit |= arg.Equals(TEXT("Quit"), ESearchCase::IgnoreCase);
+	}
+	settings.Iterations = FMath::Max(settings.Iterations, 1);
+
+	const FString json = FSessionBenchmark::ToJson(FSessionBenchmark::Run(*pSubsystem, settings));
+	UE_LOG(LogMultiplayerSessions, Display, TEXT("Session benchmark: %s"), *json);
+
+	if (!FFileHelper::SaveStringToFile(json, *filePath))
+	{
+		UE_LOG(LogMultiplayerSessions, Error, TEXT("Session benchmark could not write %s"), *filePath);
+	}
+
+	if (bQuit)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkCommand(
+	TEXT("MultiplayerSessions.Benchmark"),
+	TEXT("Benchmarks the session subsystem against a fake backend and writes the timings as json. Args: [Iterations=20] [File=<path>] [Quit]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&RunBenchmarkCommand));
@@ -0,0 +1,200 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SessionLatencyStats.h"
+#include "Stats/Stats.h"
+
+DECLARE_STATS_GROUP(TEXT("MultiplayerSessions"), STATGROUP_MultiplayerSessions, STATCAT_Advanced);
+
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Last Create (ms)"), STAT_MultiplayerSessions_LastCreate, STATGROUP_MultiplayerSessions);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Last Find (ms)"), STAT_MultiplayerSessions_LastFind, STATGROUP_MultiplayerSessions);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Last Join (ms)"), STAT_MultiplayerSessions_LastJoin, STATGROUP_MultiplayerSessions);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Last Destroy (ms)"), STAT_MultiplayerSessions_LastDestroy, STATGROUP_MultiplayerSessions);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Last Start (ms)"), STAT_MultiplayerSessions_LastStart, STATGROUP_MultiplayerSessions);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Last Resolve Connect String (ms)"), STAT_MultiplayerSessions_LastResolve, STATGROUP_MultiplayerSessions);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Last Travel (ms)"), STAT_MultiplayerSessions_LastTravel, STATGROUP_MultiplayerSessions);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Join p50 (ms)"), STAT_MultiplayerSessions_JoinP50, STATGROUP_MultiplayerSessions);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Join p99 (ms)"), STAT_MultiplayerSessions_JoinP99, STATGROUP_MultiplayerSessions);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Joins"), STAT_MultiplayerSessions_NumJoins, STATGROUP_MultiplayerSessions);
+
+//Smallest bucket and growth per bucket, 120 buckets reach a bit over 90 seconds
+static constexpr double HistogramFirstBucketSeconds = 0.001;
+static constexpr double HistogramBucketRatio = 1.1;
+static constexpr int32 NumHistogramBuckets = 120;
+
+const TCHAR* LexToString(ESessionLatencyPhase phase)
+{
+	switch (phase)
+	{
+	case ESessionLatencyPhase::Create: return TEXT("Create");
+	case ESessionLatencyPhase::Find: return TEXT("Find");
+	case ESessionLatencyPhase::Join: return TEXT("Join");
+	case ESessionLatencyPhase::Destroy: return TEXT("Destroy");
+	case ESessionLatencyPhase::Start: return TEXT("Start");
+	case ESessionLatencyPhase::ResolveConnectString: return TEXT("ResolveConnectString");
+	case ESessionLatencyPhase::Travel: return TEXT("Travel");
+	default: return TEXT("Unknown");
+	}
+}
+
+FSessionLatencyHistogram::FSessionLatencyHistogram()
+{
+	Buckets.SetNumZeroed(NumHistogramBuckets);
+}
+
+void FSessionLatencyHistogram::Add(double seconds)
+{
+	seconds = FMath::Max(seconds, 0.0);
+
+	++Buckets[GetBucketIndex(seconds)];
+	MinSeconds = Count > 0 ? FMath::Min(MinSeconds, seconds) : seconds;
+	MaxSeconds = FMath::Max(MaxSeconds, seconds);
+	TotalSeconds += seconds;
+	++Count;
+}
+
+void FSessionLatencyHistogram::Reset()
+{
+	FMemory::Memzero(Buckets.GetData(), Buckets.Num() * sizeof(int32));
+	Count = 0;
+	MinSeconds = 0.0;
+	MaxSeconds = 0.0;
+	TotalSeconds = 0.0;
+}
+
+double FSessionLatencyHistogram::GetPercentileSeconds(float percentile) const
+{
+	if (Count <= 0)
+	{
+		return 0.0;
+	}
+
+	//Rank of the sample we are looking for, counted from 1
+	const int32 rank = FMath::Clamp(FMath::CeilToInt(Count * FMath::Clamp(percentile, 0.0f, 100.0f) / 100.0f), 1, Count);
+
+	int32 numSeen = 0;
+	for (int32 bucketIndex = 0; bucketIndex < Buckets.Num(); ++bucketIndex)
+	{
+		numSeen += Buckets[bucketIndex];
+		if (numSeen >= rank)
+		{
+			return FMath::Clamp(GetBucketUpperBound(bucketIndex), MinSeconds, MaxSeconds);
+		}
+	}
+
+	return MaxSeconds;
+}
+
+int32 FSessionLatencyHistogram::GetBucketIndex(double seconds)
+{
+	if (seconds <= HistogramFirstBucketSeconds)
+	{
+		return 0;
+	}
+
+	const int32 bucketIndex = FMath::CeilToInt(FMath::Loge(seconds / HistogramFirstBucketSeconds) / FMath::Loge(HistogramBucketRatio));
+	return FMath::Clamp(bucketIndex, 0, NumHistogramBuckets - 1);
+}
+
+double FSessionLatencyHistogram::GetBucketUpperBound(int32 bucketIndex)
+{
+	return HistogramFirstBucketSeconds * FMath::Pow(HistogramBucketRatio, (double)bucketIndex);
+}
+
+void FSessionLatencyStats::BeginPhase(ESessionLatencyPhase phase)
+{
+	PhaseStartTimes[(int32)phase] = FPlatformTime::Seconds();
+}
+
+double FSessionLatencyStats::EndPhase(ESessionLatencyPhase phase)
+{
+	double& startTime = PhaseStartTimes[(int32)phase];
+	if (startTime <= 0.0)
+	{
+		return -1.0;
+	}
+
+	const double seconds = FPlatformTime::Seconds() - startTime;
+	startTime = 0.0;
+
+	Record(phase, seconds);
+	return seconds;
+}
+
+void FSessionLatencyStats::AbortPhase(ESessionLatencyPhase phase)
+{
+	PhaseStartTimes[(int32)phase] = 0.0;
+}
+
+bool FSessionLatencyStats::IsPhaseRunning(ESessionLatencyPhase phase) const
+{
+	return PhaseStartTimes[(int32)phase] > 0.0;
+}
+
+void FSessionLatencyStats::Record(ESessionLatencyPhase phase, double seconds)
+{
+	FSessionLatencyHistogram& histogram = Histograms[(int32)phase];
+	histogram.Add(seconds);
+
+	const float milliseconds = float(seconds * 1000.0);
+	switch (phase)
+	{
+	case ESessionLatencyPhase::Create:
+		SET_FLOAT_STAT(STAT_MultiplayerSessions_LastCreate, milliseconds);
+		break;
+	case ESessionLatencyPhase::Find:
+		SET_FLOAT_STAT(STAT_MultiplayerSessions_LastFind, milliseconds);
+		break;
+	case ESessionLatencyPhase::Join:
+		SET_FLOAT_STAT(STAT_MultiplayerSessions_LastJoin, milliseconds);
+		SET_FLOAT_STAT(STAT_MultiplayerSessions_JoinP50, float(histogram.GetPercentileSeconds(50.0f) * 1000.0));
+		SET_FLOAT_STAT(STAT_MultiplayerSessions_JoinP99, float(histogram.GetPercentileSeconds(99.0f) * 1000.0));
+		SET_DWORD_STAT(STAT_MultiplayerSessions_NumJoins, histogram.Num());
+		break;
+	case ESessionLatencyPhase::Destroy:
+		SET_FLOAT_STAT(STAT_MultiplayerSessions_LastDestroy, milliseconds);
+		break;
+	case ESessionLatencyPhase::Start:
+		SET_FLOAT_STAT(STAT_MultiplayerSessions_LastStart, milliseconds);
+		break;
+	case ESessionLatencyPhase::ResolveConnectString:
+		SET_FLOAT_STAT(STAT_MultiplayerSessions_LastResolve, milliseconds);
+		break;
+	case ESessionLatencyPhase::Travel:
+		SET_FLOAT_STAT(STAT_MultiplayerSessions_LastTravel, milliseconds);
+		break;
+	default:
+		break;
+	}
+}
+
+void FSessionLatencyStats::Reset()
+{
+	for (int32 phaseIndex = 0; phaseIndex < (int32)ESessionLatencyPhase::Num; ++phaseIndex)
+	{
+		Histograms[phaseIndex].Reset();
+		PhaseStartTimes[phaseIndex] = 0.0;
+	}
+}
+
+const FSessionLatencyHistogram& FSessionLatencyStats::GetHistogram(ESessionLatencyPhase phase) const
+{
+	return Histograms[(int32)phase];
+}
+
+FString FSessionLatencyStats::ToString() const
+{
+	FString result;
+	for (int32 phaseIndex = 0; phaseIndex < (int32)ESessionLatencyPhase::Num; ++phaseIndex)
+	{
+		const FSessionLatencyHistogram& histogram = Histograms[phaseIndex];
+		result += FString::Printf(TEXT("%-22s count %5d  mean %8.1f ms  p50 %8.1f ms  p99 %8.1f ms  max %8.1f ms\n"),
+			LexToString((ESessionLatencyPhase)phaseIndex),
+			histogram.Num(),
+			histogram.GetMeanSeconds() * 1000.0,
+			histogram.GetPercentileSeconds(50.0f) * 1000.0,
+			histogram.GetPercentileSeconds(99.0f) * 1000.0,
+			histogram.GetMaxSeconds() * 1000.0);
+	}
+	return result;
+}
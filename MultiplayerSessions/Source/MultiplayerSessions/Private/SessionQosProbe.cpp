@@ -0,0 +1,395 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SessionQosProbe.h"
+#include "MultiplayerSessions.h"
+#include "MultiplayerSessionsTrace.h"
+#include "Async/Async.h"
+#include "HAL/RunnableThread.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+#include "IPAddress.h"
+#include "Common/UdpSocketBuilder.h"
+#include "Interfaces/IPv4/IPv4Endpoint.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "Misc/Guid.h"
+
+/*
+* Packet layout, all little endian
+* uint32 Magic, uint8 Version, uint8 PacketType, uint32 Token, uint16 TargetIndex, uint8 Sequence
+* The responder sends the probe back as it came in, with the packet type switched to Echo
+* Token tells the replies of different probe runs apart, TargetIndex and Sequence pick the send time of the probe
+*/
+static constexpr uint32 QosPacketMagic = 0x51534D53;
+static constexpr uint8 QosPacketVersion = 1;
+static constexpr int32 QosPacketTypeOffset = 5;
+static constexpr int32 MaxQosPacketBytes = 64;
+static constexpr int32 MaxProbesPerTarget = 255;
+//Longest the prober sleeps on the socket, bounds how late a cancel or the next round is noticed
+static constexpr double MaxQosWaitSeconds = 0.005;
+//Same for the responder, which only needs to notice it is being stopped
+static constexpr double ResponderWaitSeconds = 0.05;
+
+enum class EQosPacketType : uint8
+{
+	Probe = 1,
+	Echo = 2
+};
+
+struct FSessionQosProbeState
+{
+	std::atomic<bool> bCancelled{ false };
+	//Game thread only
+	FSessionQosProber::FOnProbeComplete OnComplete;
+};
+
+static void WriteQosPacket(TArray<uint8>& outPacket, uint32 token, uint16 targetIndex, uint8 sequence)
+{
+	outPacket.Reset();
+	FMemoryWriter writer(outPacket);
+	uint32 magic = QosPacketMagic;
+	uint8 version = QosPacketVersion;
+	uint8 type = (uint8)EQosPacketType::Probe;
+	writer << magic << version << type << token << targetIndex << sequence;
+}
+
+static bool ReadQosPacket(const uint8* pData, int32 numBytes, EQosPacketType expectedType, uint32& outToken, uint16& outTargetIndex, uint8& outSequence)
+{
+	FMemoryReader reader(TArrayView<const uint8>(pData, numBytes));
+	uint32 magic = 0;
+	uint8 version = 0;
+	uint8 type = 0;
+	reader << magic << version << type << outToken << outTargetIndex << outSequence;
+	return !reader.IsError() && magic == QosPacketMagic && version == QosPacketVersion && type == (uint8)expectedType;
+}
+
+static float GetMedian(TArray<float>& values)
+{
+	values.Sort();
+	const int32 middle = values.Num() / 2;
+	return values.Num() % 2 == 1 ? values[middle] : (values[middle - 1] + values[middle]) * 0.5f;
+}
+
+/*
+* Runs on the worker thread, blocks until every probe came back, timed out or the probe got cancelled
+*/
+static TArray<FSessionQosMeasurement> RunQosProbe(const TArray<FSessionQosTarget>& targets, const FSessionQosProbeSettings& settings, const std::atomic<bool>& bCancelled)
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(RunQosProbe);
+
+	TArray<FSessionQosMeasurement> measurements;
+	measurements.SetNum(targets.Num());
+
+	//Hosts behind a relay have no ip to probe, they keep the ping the backend reported
+	TArray<TSharedPtr<FInternetAddr>> addresses;
+	addresses.SetNum(targets.Num());
+	int32 numProbedTargets = 0;
+	for (int32 targetIndex = 0; targetIndex < targets.Num(); ++targetIndex)
+	{
+		FIPv4Endpoint endpoint;
+		if (FIPv4Endpoint::Parse(targets[targetIndex].Address, endpoint) && endpoint.Port != 0)
+		{
+			addresses[targetIndex] = endpoint.ToInternetAddr();
+			++numProbedTargets;
+		}
+	}
+
+	if (numProbedTargets == 0)
+	{
+		return measurements;
+	}
+
+	FSocket* pSocket = FUdpSocketBuilder(TEXT("SessionQosProbe"))
+		.AsNonBlocking()
+		.BoundToPort(0)
+		.WithReceiveBufferSize(64 * 1024)
+		.Build();
+	if (!pSocket)
+	{
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("Failed to create QoS probe socket"));
+		return measurements;
+	}
+
+	ISocketSubsystem* pSockets = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	TSharedRef<FInternetAddr> senderAddress = pSockets->CreateInternetAddr();
+
+	const int32 numProbes = FMath::Clamp(settings.ProbesPerTarget, 1, MaxProbesPerTarget);
+	const uint32 token = FGuid::NewGuid().A;
+	//Send time and round trip time of every probe, target major, a negative round trip time is a probe still out
+	TArray<double> sendTimes;
+	sendTimes.SetNumZeroed(targets.Num() * numProbes);
+	TArray<float> rttSeconds;
+	rttSeconds.Init(-1.0f, targets.Num() * numProbes);
+
+	TArray<uint8> packet;
+	uint8 receiveBuffer[MaxQosPacketBytes];
+	int32 numRounds = 0;
+	int32 numOutstanding = 0;
+	double nextRoundTime = FPlatformTime::Seconds();
+	double deadline = 0.0;
+
+	while (!bCancelled)
+	{
+		double now = FPlatformTime::Seconds();
+		if (numRounds < numProbes && now >= nextRoundTime)
+		{
+			//Every target gets the probe of this round back to back, so all of them are measured at the same time
+			for (int32 targetIndex = 0; targetIndex < targets.Num(); ++targetIndex)
+			{
+				if (!addresses[targetIndex].IsValid())
+				{
+					continue;
+				}
+
+				WriteQosPacket(packet, token, (uint16)targetIndex, (uint8)numRounds);
+				int32 bytesSent = 0;
+				sendTimes[targetIndex * numProbes + numRounds] = FPlatformTime::Seconds();
+				if (pSocket->SendTo(packet.GetData(), packet.Num(), bytesSent, *addresses[targetIndex]))
+				{
+					++measurements[targetIndex].NumSent;
+					++numOutstanding;
+				}
+			}
+
+			++numRounds;
+			nextRoundTime = now + settings.IntervalSeconds;
+			if (numRounds == numProbes)
+			{
+				deadline = now + settings.TimeoutSeconds;
+			}
+		}
+
+		if (numRounds == numProbes && (numOutstanding <= 0 || now >= deadline))
+		{
+			break;
+		}
+
+		const double wakeTime = numRounds < numProbes ? nextRoundTime : deadline;
+		const double waitSeconds = FMath::Clamp(wakeTime - now, 0.0, MaxQosWaitSeconds);
+		if (!pSocket->Wait(ESocketWaitConditions::WaitForRead, FTimespan::FromSeconds(waitSeconds)))
+		{
+			continue;
+		}
+
+		int32 bytesRead = 0;
+		while (pSocket->RecvFrom(receiveBuffer, MaxQosPacketBytes, bytesRead, *senderAddress) && bytesRead > 0)
+		{
+			now = FPlatformTime::Seconds();
+
+			uint32 replyToken = 0;
+			uint16 targetIndex = 0;
+			uint8 sequence = 0;
+			if (!ReadQosPacket(receiveBuffer, bytesRead, EQosPacketType::Echo, replyToken, targetIndex, sequence))
+			{
+				continue;
+			}
+
+			//Replies to an older run, a probe we never sent, or a duplicate
+			if (replyToken != token || targetIndex >= targets.Num() || sequence >= numRounds)
+			{
+				continue;
+			}
+
+			const int32 probeIndex = targetIndex * numProbes + sequence;
+			if (rttSeconds[probeIndex] >= 0.0f)
+			{
+				continue;
+			}
+
+			rttSeconds[probeIndex] = float(now - sendTimes[probeIndex]);
+			++measurements[targetIndex].NumReceived;
+			--numOutstanding;
+		}
+	}
+
+	pSocket->Close();
+	pSockets->DestroySocket(pSocket);
+
+	TArray<float> samples;
+	for (int32 targetIndex = 0; targetIndex < targets.Num(); ++targetIndex)
+	{
+		FSessionQosMeasurement& measurement = measurements[targetIndex];
+		if (!measurement.IsReachable())
+		{
+			continue;
+		}
+
+		//Jitter between consecutive probes that came back, in the order they were sent
+		samples.Reset();
+		float jitterSum = 0.0f;
+		for (int32 sequence = 0; sequence < numProbes; ++sequence)
+		{
+			const float rttMs = rttSeconds[targetIndex * numProbes + sequence] * 1000.0f;
+			if (rttMs < 0.0f)
+			{
+				continue;
+			}
+
+			if (samples.Num() > 0)
+			{
+				jitterSum += FMath::Abs(rttMs - samples.Last());
+			}
+			samples.Add(rttMs);
+		}
+
+		measurement.JitterMs = samples.Num() > 1 ? jitterSum / (samples.Num() - 1) : 0.0f;
+		measurement.RttMs = GetMedian(samples);
+	}
+
+	return measurements;
+}
+
+FSessionQosProber::~FSessionQosProber()
+{
+	CancelProbe();
+}
+
+bool FSessionQosProber::StartProbe(const TArray<FSessionQosTarget>& targets, const FSessionQosProbeSettings& settings, FOnProbeComplete&& onComplete)
+{
+	CancelProbe();
+
+	if (targets.Num() == 0)
+	{
+		return false;
+	}
+
+	//The worker only holds the shared state, so the prober can go away while it runs
+	TSharedRef<FSessionQosProbeState, ESPMode::ThreadSafe> state = MakeShared<FSessionQosProbeState, ESPMode::ThreadSafe>();
+	state->OnComplete = MoveTemp(onComplete);
+	State = state;
+
+	Async(EAsyncExecution::ThreadPool, [state, targets, settings]()
+	{
+		TArray<FSessionQosMeasurement> measurements = RunQosProbe(targets, settings, state->bCancelled);
+
+		AsyncTask(ENamedThreads::GameThread, [state, measurements = MoveTemp(measurements)]()
+		{
+			if (state->bCancelled)
+			{
+				return;
+			}
+
+			FOnProbeComplete onComplete = MoveTemp(state->OnComplete);
+			state->OnComplete.Unbind();
+			onComplete.ExecuteIfBound(measurements);
+		});
+	});
+
+	return true;
+}
+
+void FSessionQosProber::CancelProbe()
+{
+	if (!State.IsValid())
+	{
+		return;
+	}
+
+	State->bCancelled = true;
+	State->OnComplete.Unbind();
+	State.Reset();
+}
+
+bool FSessionQosProber::IsProbing() const
+{
+	return State.IsValid() && State->OnComplete.IsBound();
+}
+
+FSessionQosResponder::FSessionQosResponder(int32 port):
+	Port(port)
+{
+}
+
+FSessionQosResponder::~FSessionQosResponder()
+{
+	StopResponding();
+}
+
+bool FSessionQosResponder::StartResponding()
+{
+	StopResponding();
+
+	Socket = FUdpSocketBuilder(TEXT("SessionQosResponder"))
+		.AsNonBlocking()
+		.AsReusable()
+		.BoundToPort(Port)
+		.WithReceiveBufferSize(64 * 1024)
+		.Build();
+	if (!Socket)
+	{
+		UE_LOG(LogMultiplayerSessions, Warning, TEXT("Failed to create QoS responder socket on port %d"), Port);
+		return false;
+	}
+
+	TSharedRef<FInternetAddr> boundAddress = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->CreateInternetAddr();
+	Socket->GetAddress(*boundAddress);
+	BoundPort = boundAddress->GetPort();
+
+	bStopping = false;
+	Thread = FRunnableThread::Create(this, TEXT("SessionQosResponder"), 0, TPri_AboveNormal);
+	if (!Thread)
+	{
+		StopResponding();
+		return false;
+	}
+	return true;
+}
+
+void FSessionQosResponder::StopResponding()
+{
+	if (Thread)
+	{
+		//Kill stops the runnable and waits for it, the loop wakes up within ResponderWaitSeconds
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+
+	if (Socket)
+	{
+		Socket->Close();
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+		Socket = nullptr;
+	}
+	BoundPort = 0;
+}
+
+uint32 FSessionQosResponder::Run()
+{
+	ISocketSubsystem* pSockets = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	TSharedRef<FInternetAddr> senderAddress = pSockets->CreateInternetAddr();
+	uint8 buffer[MaxQosPacketBytes];
+
+	while (!bStopping)
+	{
+		if (!Socket->Wait(ESocketWaitConditions::WaitForRead, FTimespan::FromSeconds(ResponderWaitSeconds)))
+		{
+			continue;
+		}
+
+		int32 bytesRead = 0;
+		while (Socket->RecvFrom(buffer, MaxQosPacketBytes, bytesRead, *senderAddress) && bytesRead > 0)
+		{
+			uint32 token = 0;
+			uint16 targetIndex = 0;
+			uint8 sequence = 0;
+			if (!ReadQosPacket(buffer, bytesRead, EQosPacketType::Probe, token, targetIndex, sequence))
+			{
+				continue;
+			}
+
+			//Send it straight back, the prober only needs its own fields back
+			buffer[QosPacketTypeOffset] = (uint8)EQosPacketType::Echo;
+			int32 bytesSent = 0;
+			Socket->SendTo(buffer, bytesRead, bytesSent, *senderAddress);
+		}
+	}
+
+	return 0;
+}
+
+void FSessionQosResponder::Stop()
+{
+	bStopping = true;
+}
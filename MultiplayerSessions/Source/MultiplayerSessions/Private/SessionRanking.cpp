@@ -0,0 +1,189 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SessionRanking.h"
+
+//Ping backends report when they could not measure it
+static constexpr int32 MaxQueryPingInMs = 9999;
+
+//Forgets the hosts updated longest ago until no more than maxHosts are left
+template<typename RecordType>
+static void TrimOldestHosts(TMap<FString, RecordType>& records, int32 maxHosts)
+{
+	while (records.Num() > FMath::Max(maxHosts, 0))
+	{
+		FString oldestSessionId;
+		double oldestUpdateTime = TNumericLimits<double>::Max();
+		for (const TPair<FString, RecordType>& record : records)
+		{
+			if (record.Value.UpdateTime < oldestUpdateTime)
+			{
+				oldestSessionId = record.Key;
+				oldestUpdateTime = record.Value.UpdateTime;
+			}
+		}
+		records.Remove(oldestSessionId);
+	}
+}
+
+bool FSessionRanker::ScoreResult(const FOnlineSessionSearchResult& result, float& outCost) const
+{
+	const FOnlineSession& session = result.Session;
+	if (session.NumOpenPublicConnections < Weights.RequiredOpenSlots)
+	{
+		return false;
+	}
+
+	if (Weights.bRequireMatchingBuild && session.SessionSettings.BuildUniqueId != BuildUniqueId)
+	{
+		return false;
+	}
+
+	const FString sessionId = result.GetSessionIdStr();
+
+	const int32 pingInMs = IsPingKnown(result.PingInMs) ? result.PingInMs : Weights.UnknownPingInMs;
+	float cost = pingInMs * Weights.PingWeight;
+
+	//Our own measurement beats whatever the backend reported
+	const FQosRecord* pQosRecord = QosMeasurements.Find(sessionId);
+	const FSessionQosMeasurement* pMeasurement = pQosRecord ? &pQosRecord->Measurement : nullptr;
+	if (pMeasurement && pMeasurement->WasProbed())
+	{
+		if (pMeasurement->IsReachable())
+		{
+			cost = pMeasurement->RttMs * Weights.PingWeight + pMeasurement->JitterMs * Weights.JitterWeight;
+		}
+		cost += Weights.PacketLossCost * pMeasurement->GetLossRate();
+	}
+
+	const int32 numSlots = session.SessionSettings.NumPublicConnections;
+	if (numSlots > 0)
+	{
+		cost += Weights.EmptySessionCost * session.NumOpenPublicConnections / numSlots;
+	}
+
+	if (const FHostFailures* pHostFailures = HostFailures.Find(sessionId))
+	{
+		cost += Weights.HostFailureCost * pHostFailures->NumFailures;
+	}
+
+	outCost = cost;
+	return true;
+}
+
+float FSessionRanker::GetUnknownPingCost(const FOnlineSessionSearchResult& result) const
+{
+	if (IsPingKnown(result.PingInMs))
+	{
+		return 0.0f;
+	}
+
+	const FQosRecord* pQosRecord = QosMeasurements.Find(result.GetSessionIdStr());
+	if (pQosRecord && pQosRecord->Measurement.IsReachable())
+	{
+		return 0.0f;
+	}
+
+	return Weights.UnknownPingInMs * Weights.PingWeight;
+}
+
+bool FSessionRanker::IsPingKnown(int32 pingInMs)
+{
+	return pingInMs > 0 && pingInMs < MaxQueryPingInMs;
+}
+
+void FSessionRanker::AddCandidate(TArrayView<const FOnlineSessionSearchResult> searchResults, int32 resultIndex, int32 topK, TArray<FRankedSession>& heap) const
+{
+	float cost;
+	if (!ScoreResult(searchResults[resultIndex], cost))
+	{
+		return;
+	}
+
+	//Max heap on cost, the worst kept candidate sits on top and is the one to replace
+	auto worstOnTop = [](const FRankedSession& a, const FRankedSession& b)
+	{
+		return a.Cost > b.Cost;
+	};
+
+	if (heap.Num() < topK)
+	{
+		heap.HeapPush(FRankedSession{ resultIndex, cost }, worstOnTop);
+	}
+	else if (cost < heap.HeapTop().Cost)
+	{
+		heap.HeapPopDiscard(worstOnTop, false);
+		heap.HeapPush(FRankedSession{ resultIndex, cost }, worstOnTop);
+	}
+}
+
+void FSessionRanker::RankTopK(TArrayView<const FOnlineSessionSearchResult> searchResults, TArrayView<const int32> candidates, int32 topK, TArray<FRankedSession>& outRanked) const
+{
+	outRanked.Reset();
+	if (topK <= 0)
+	{
+		return;
+	}
+
+	outRanked.Reserve(topK);
+	for (const int32 resultIndex : candidates)
+	{
+		AddCandidate(searchResults, resultIndex, topK, outRanked);
+	}
+
+	//Only K entries left to sort
+	outRanked.Sort([](const FRankedSession& a, const FRankedSession& b)
+	{
+		return a.Cost < b.Cost;
+	});
+}
+
+void FSessionRanker::RankTopK(TArrayView<const FOnlineSessionSearchResult> searchResults, int32 topK, TArray<FRankedSession>& outRanked) const
+{
+	outRanked.Reset();
+	if (topK <= 0)
+	{
+		return;
+	}
+
+	outRanked.Reserve(topK);
+	for (int32 resultIndex = 0; resultIndex < searchResults.Num(); ++resultIndex)
+	{
+		AddCandidate(searchResults, resultIndex, topK, outRanked);
+	}
+
+	outRanked.Sort([](const FRankedSession& a, const FRankedSession& b)
+	{
+		return a.Cost < b.Cost;
+	});
+}
+
+void FSessionRanker::RecordJoinResult(const FString& sessionId, EOnJoinSessionCompleteResult::Type result)
+{
+	switch (result)
+	{
+	case EOnJoinSessionCompleteResult::Success:
+		HostFailures.Remove(sessionId);
+		break;
+	case EOnJoinSessionCompleteResult::CouldNotRetrieveAddress:
+	case EOnJoinSessionCompleteResult::UnknownError:
+	{
+		FHostFailures& hostFailures = HostFailures.FindOrAdd(sessionId);
+		++hostFailures.NumFailures;
+		hostFailures.UpdateTime = FPlatformTime::Seconds();
+		TrimOldestHosts(HostFailures, MaxRememberedHosts);
+		break;
+	}
+	default:
+		//Full, gone or already joined says nothing about how reachable the host is
+		break;
+	}
+}
+
+void FSessionRanker::SetQosMeasurement(const FString& sessionId, const FSessionQosMeasurement& measurement)
+{
+	FQosRecord& qosRecord = QosMeasurements.FindOrAdd(sessionId);
+	qosRecord.Measurement = measurement;
+	qosRecord.UpdateTime = FPlatformTime::Seconds();
+	TrimOldestHosts(QosMeasurements, MaxRememberedHosts);
+}
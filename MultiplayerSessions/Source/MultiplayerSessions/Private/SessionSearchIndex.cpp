@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SessionSearchIndex.h"
+
+uint32 FSessionSearchIndex::FValueKeyFuncs::GetKeyHash(const FVariantData& key)
+{
+	switch (key.GetType())
+	{
+	case EOnlineKeyValuePairDataType::Int32:
+	{
+		int32 value = 0;
+		key.GetValue(value);
+		return GetTypeHash(value);
+	}
+	case EOnlineKeyValuePairDataType::Int64:
+	{
+		int64 value = 0;
+		key.GetValue(value);
+		return GetTypeHash(value);
+	}
+	case EOnlineKeyValuePairDataType::Bool:
+	{
+		bool bValue = false;
+		key.GetValue(bValue);
+		return GetTypeHash(bValue);
+	}
+	default:
+		//Rare in session settings, not worth a case of their own
+		return GetTypeHash(key.ToString());
+	}
+}
+
+void FSessionSearchIndex::Reset(const TSharedPtr<FOnlineSessionSearch>& sessionSearch, const TArray<FName>& indexedKeys)
+{
+	Clear();
+
+	SessionSearch = sessionSearch;
+	IndexedKeys = indexedKeys;
+	for (const FName& key : IndexedKeys)
+	{
+		Buckets.Add(key);
+	}
+}
+
+void FSessionSearchIndex::Update()
+{
+	if (!SessionSearch.IsValid())
+	{
+		return;
+	}
+
+	const TArray<FOnlineSessionSearchResult>& searchResults = SessionSearch->SearchResults;
+	for (int32 i = NumIndexedResults; i < searchResults.Num(); ++i)
+	{
+		const FOnlineSessionSettings& settings = searchResults[i].Session.SessionSettings;
+		for (TPair<FName, FValueBuckets>& keyBuckets : Buckets)
+		{
+			const FOnlineSessionSetting* pSetting = settings.Settings.Find(keyBuckets.Key);
+			if (pSetting)
+			{
+				keyBuckets.Value.FindOrAdd(pSetting->Data).Add(i);
+			}
+		}
+	}
+
+	NumIndexedResults = searchResults.Num();
+}
+
+void FSessionSearchIndex::Clear()
+{
+	SessionSearch.Reset();
+	IndexedKeys.Reset();
+	Buckets.Reset();
+	NumIndexedResults = 0;
+}
+
+const TArray<int32>& FSessionSearchIndex::FindResults(FName key, const FVariantData& value) const
+{
+	static const TArray<int32> NoResults;
+
+	const FValueBuckets* pKeyBuckets = Buckets.Find(key);
+	if (!pKeyBuckets)
+	{
+		return NoResults;
+	}
+
+	const TArray<int32>* pResults = pKeyBuckets->Find(value);
+	return pResults ? *pResults : NoResults;
+}
+
+const FOnlineSessionSearchResult* FSessionSearchIndex::FindFirstResult(FName key, const FVariantData& value) const
+{
+	const TArray<int32>& results = FindResults(key, value);
+	return results.Num() > 0 ? &GetResult(results[0]) : nullptr;
+}
@@ -0,0 +1,185 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SessionSearchQuery.h"
+#include "SessionAttributes.h"
+
+static bool TryGetNumber(const FVariantData& data, double& outNumber)
+{
+	switch (data.GetType())
+	{
+	case EOnlineKeyValuePairDataType::Int32:
+	{
+		int32 value;
+		data.GetValue(value);
+		outNumber = value;
+		return true;
+	}
+	case EOnlineKeyValuePairDataType::UInt32:
+	{
+		uint32 value;
+		data.GetValue(value);
+		outNumber = value;
+		return true;
+	}
+	case EOnlineKeyValuePairDataType::Int64:
+	{
+		int64 value;
+		data.GetValue(value);
+		outNumber = static_cast<double>(value);
+		return true;
+	}
+	case EOnlineKeyValuePairDataType::UInt64:
+	{
+		uint64 value;
+		data.GetValue(value);
+		outNumber = static_cast<double>(value);
+		return true;
+	}
+	case EOnlineKeyValuePairDataType::Float:
+	{
+		float value;
+		data.GetValue(value);
+		outNumber = value;
+		return true;
+	}
+	case EOnlineKeyValuePairDataType::Double:
+		data.GetValue(outNumber);
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool CompareSettingValue(const FVariantData& value, const FVariantData& target, EOnlineComparisonOp::Type comparisonOp)
+{
+	switch (comparisonOp)
+	{
+	case EOnlineComparisonOp::Equals:
+		return value == target;
+	case EOnlineComparisonOp::NotEquals:
+		return value != target;
+	default:
+		break;
+	}
+
+	double number;
+	double targetNumber;
+	if (!TryGetNumber(value, number) || !TryGetNumber(target, targetNumber))
+	{
+		//Near, In and NotIn can't be evaluated here, leave them to the backend
+		return true;
+	}
+
+	switch (comparisonOp)
+	{
+	case EOnlineComparisonOp::GreaterThan:
+		return number > targetNumber;
+	case EOnlineComparisonOp::GreaterThanEquals:
+		return number >= targetNumber;
+	case EOnlineComparisonOp::LessThan:
+		return number < targetNumber;
+	case EOnlineComparisonOp::LessThanEquals:
+		return number <= targetNumber;
+	default:
+		return true;
+	}
+}
+
+void FSessionSearchQuery::ApplyTo(FOnlineSessionSearch& sessionSearch) const
+{
+	sessionSearch.MaxSearchResults = MaxSearchResults;
+	if (bDedicatedServers)
+	{
+		sessionSearch.QuerySettings.Set(SEARCH_DEDICATED_ONLY, true, EOnlineComparisonOp::Equals);
+	}
+	else
+	{
+		sessionSearch.QuerySettings.Set(SEARCH_PRESENCE, true, EOnlineComparisonOp::Equals);
+	}
+
+	if (!MatchType.IsEmpty())
+	{
+		sessionSearch.QuerySettings.Set(SESSION_ATTRIBUTE_MATCHTYPE, FSessionAttributes::PackMatchType(MatchType), EOnlineComparisonOp::Equals);
+	}
+
+	for (const FSessionSearchPredicate& predicate : Predicates)
+	{
+		FOnlineSessionSearchParam searchParam(0, predicate.ComparisonOp);
+		searchParam.Data = predicate.Value;
+		sessionSearch.QuerySettings.SearchParams.Add(predicate.Key, searchParam);
+	}
+}
+
+bool FSessionSearchQuery::Matches(const FOnlineSessionSearchResult& result) const
+{
+	const FOnlineSessionSettings& settings = result.Session.SessionSettings;
+
+	if (bDedicatedServers && !settings.bIsDedicated)
+	{
+		return false;
+	}
+
+	if (!MatchType.IsEmpty())
+	{
+		FSessionAttributes attributes;
+		if (!FSessionAttributes::Read(settings, attributes) || !attributes.HasMatchType(MatchType))
+		{
+			return false;
+		}
+	}
+
+	for (const FSessionSearchPredicate& predicate : Predicates)
+	{
+		const FOnlineSessionSetting* pSetting = settings.Settings.Find(predicate.Key);
+		if (!pSetting || !CompareSettingValue(pSetting->Data, predicate.Value, predicate.ComparisonOp))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool FSessionSearchQuery::Covers(const FSessionSearchQuery& other) const
+{
+	return MaxSearchResults >= other.MaxSearchResults && MatchType == other.MatchType && Predicates == other.Predicates && bDedicatedServers == other.bDedicatedServers;
+}
+
+bool FSessionSearchQuery::MatchesSearchSettings(const FOnlineSearchSettings& querySettings, const FOnlineSessionSearchResult& result)
+{
+	const FOnlineSessionSettings& settings = result.Session.SessionSettings;
+
+	for (const TPair<FName, FOnlineSessionSearchParam>& searchParam : querySettings.SearchParams)
+	{
+		//Not an advertised setting, compare against the session settings themselves
+		if (searchParam.Key == SEARCH_DEDICATED_ONLY)
+		{
+			bool bDedicatedOnly = false;
+			searchParam.Value.Data.GetValue(bDedicatedOnly);
+			if (bDedicatedOnly && !settings.bIsDedicated)
+			{
+				return false;
+			}
+			continue;
+		}
+
+		const FOnlineSessionSetting* pSetting = settings.Settings.Find(searchParam.Key);
+		if (!pSetting)
+		{
+			if (searchParam.Key == SEARCH_PRESENCE || searchParam.Key == SEARCH_LOBBIES || searchParam.Key == SEARCH_KEYWORDS)
+			{
+				continue;
+			}
+
+			return false;
+		}
+
+		if (!CompareSettingValue(pSetting->Data, searchParam.Value.Data, searchParam.Value.ComparisonOp))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
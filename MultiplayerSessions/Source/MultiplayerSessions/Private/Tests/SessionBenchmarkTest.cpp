@@ -0,0 +1,82 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "SessionBenchmark.h"
+#include "MultiplayerSessionsSubsystem.h"
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "Misc/FileHelper.h"
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FSessionBenchmarkTest, "MultiplayerSessions.Benchmark", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FSessionBenchmarkTest::RunTest(const FString& parameters)
+{
+	if (!GEngine)
+	{
+		AddError(TEXT("Session benchmark needs an engine"));
+		return false;
+	}
+
+	//Any game instance with the subsystem will do, the benchmark swaps in the fake backend and puts the old interface back
+	UMultiplayerSessionsSubsystem* pSubsystem = nullptr;
+	for (const FWorldContext& worldContext : GEngine->GetWorldContexts())
+	{
+		UGameInstance* pGame = worldContext.OwningGameInstance;
+		pSubsystem = pGame ? pGame->GetSubsystem<UMultiplayerSessionsSubsystem>() : nullptr;
+		if (pSubsystem)
+		{
+			break;
+		}
+	}
+
+	//Outside of PIE or a game there is none, the benchmark gets a game instance of its own
+	UGameInstance* pOwnGame = nullptr;
+	if (!pSubsystem)
+	{
+		pOwnGame = NewObject<UGameInstance>(GEngine);
+		pOwnGame->InitializeStandalone();
+		pSubsystem = pOwnGame->GetSubsystem<UMultiplayerSessionsSubsystem>();
+	}
+
+	if (pSubsystem)
+	{
+		const TArray<FSessionBenchmarkResult> results = FSessionBenchmark::Run(*pSubsystem);
+
+		//CI picks up the timings from the same file the console command writes
+		const FString filePath = FSessionBenchmark::GetDefaultJsonPath();
+		if (!FFileHelper::SaveStringToFile(FSessionBenchmark::ToJson(results), *filePath))
+		{
+			AddError(FString::Printf(TEXT("Could not write %s"), *filePath));
+		}
+
+		for (const FSessionBenchmarkResult& result : results)
+		{
+			TestEqual(FString::Printf(TEXT("%s failures"), *result.Name), result.NumFailures, 0);
+			TestTrue(FString::Printf(TEXT("%s has samples"), *result.Name), result.Timings.Num() > 0);
+		}
+	}
+	else
+	{
+		AddError(TEXT("No MultiplayerSessionsSubsystem on the game instance"));
+	}
+
+	if (pOwnGame)
+	{
+		UWorld* pWorld = pOwnGame->GetWorld();
+		pOwnGame->Shutdown();
+		if (pWorld)
+		{
+			GEngine->DestroyWorldContext(pWorld);
+			pWorld->DestroyWorld(false);
+		}
+	}
+
+	return !HasAnyErrors();
+}
+
+#endif
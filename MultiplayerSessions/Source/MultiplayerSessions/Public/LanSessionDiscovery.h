@@ -0,0 +1,139 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+#include "OnlineSessionSettings.h"
+
+class FSocket;
+class FInternetAddr;
+
+/*
+* What a host tells LAN clients about its session
+* Sent as a small binary packet, see LanSessionDiscovery.cpp for the layout
+*/
+struct MULTIPLAYERSESSIONS_API FLanSessionAdvert
+{
+	//Packed match type of FSessionAttributes
+	int32 MatchType{ 0 };
+	FString OwningUserName;
+	int32 BuildUniqueId{ 0 };
+	int32 OpenSlots{ 0 };
+	int32 MaxSlots{ 0 };
+	//Port the host accepts game connections on, the address is the one the reply came from
+	int32 GamePort{ 7777 };
+};
+
+/*
+* What a LAN client asks for
+*/
+struct MULTIPLAYERSESSIONS_API FLanSessionDiscoveryQuery
+{
+	//Packed match type of FSessionAttributes, 0 finds every match type
+	int32 MatchType{ 0 };
+	int32 BuildUniqueId{ 0 };
+	//Stops as soon as this many hosts replied
+	int32 MaxResults{ 100 };
+	//Stops after this long whatever the amount of replies
+	float TimeoutSeconds{ 0.5f };
+	//Stops when no new host replied for this long after the first reply, 0 waits for the timeout
+	float QuietSeconds{ 0.05f };
+	//The query is sent again at this interval, in case a packet got lost
+	float ResendIntervalSeconds{ 0.1f };
+};
+
+/*
+* Session info of hosts found by LAN discovery
+* There is no backend session behind it, joining travels straight to the host address
+*/
+class MULTIPLAYERSESSIONS_API FOnlineSessionInfoLanDiscovery : public FOnlineSessionInfo
+{
+public:
+	FOnlineSessionInfoLanDiscovery(const FString& sessionId, const FString& hostAddress);
+
+	virtual const uint8* GetBytes() const override { return nullptr; }
+	virtual int32 GetSize() const override { return sizeof(FOnlineSessionInfoLanDiscovery); }
+	virtual bool IsValid() const override { return SessionId->IsValid(); }
+	virtual const FUniqueNetId& GetSessionId() const override { return *SessionId; }
+	virtual FString ToString() const override { return SessionId->ToString(); }
+	virtual FString ToDebugString() const override { return FString::Printf(TEXT("SessionId: %s HostAddress: %s"), *SessionId->ToDebugString(), *HostAddress); }
+
+	const FString& GetHostAddress() const { return HostAddress; }
+
+private:
+	FUniqueNetIdRef SessionId;
+	FString HostAddress;
+};
+
+/*
+* Fast LAN discovery, used instead of the generic LAN beacon of the NULL online subsystem
+* Hosts listen on a multicast group and answer queries with a compact advert, clients multicast a query and
+* stop as soon as enough hosts replied instead of waiting out a fixed timeout
+* Multicast loopback is on, so hosts and clients on the same machine find each other
+* Game thread only, sockets are polled from the core ticker
+*/
+class MULTIPLAYERSESSIONS_API FLanSessionDiscovery
+{
+public:
+	DECLARE_DELEGATE_RetVal_OneParam(bool, FOnFillAdvert, FLanSessionAdvert& /*outAdvert*/);
+	DECLARE_DELEGATE_OneParam(FOnHostFound, const FOnlineSessionSearchResult& /*result*/);
+	DECLARE_DELEGATE_OneParam(FOnDiscoveryComplete, bool /*bWasSuccessful*/);
+
+	FLanSessionDiscovery(const FString& multicastGroup, int32 port);
+	~FLanSessionDiscovery();
+
+	/*
+	* Host side
+	* onFillAdvert is asked for the advert every time a query comes in, so open slots are always current
+	* Returning false from it skips the reply
+	*/
+	bool StartAdvertising(FOnFillAdvert&& onFillAdvert);
+	void StopAdvertising();
+	bool IsAdvertising() const { return AdvertSocket != nullptr; }
+
+	/*
+	* Client side
+	* onHostFound runs for every host that replies, onComplete once when the query stopped
+	*/
+	bool StartQuery(const FLanSessionDiscoveryQuery& query, FOnHostFound&& onHostFound, FOnDiscoveryComplete&& onComplete);
+	//Stops the query without calling onComplete
+	void StopQuery();
+	bool IsQuerying() const { return QuerySocket != nullptr; }
+
+	/*
+	* Host address of a result found by LAN discovery, false for results of any other backend
+	*/
+	static bool GetHostAddress(const FOnlineSessionSearchResult& result, FString& outHostAddress);
+
+private:
+	bool TickAdvertising(float deltaTime);
+	bool TickQuery(float deltaTime);
+	void SendQuery();
+	void CompleteQuery(bool bWasSuccessful);
+	FSocket* CreateSocket(const TCHAR* description, bool bJoinGroup) const;
+	void DestroySocket(FSocket*& pSocket) const;
+
+	TSharedPtr<FInternetAddr> GroupAddress;
+	int32 Port{ 0 };
+
+	FSocket* AdvertSocket{ nullptr };
+	FTSTicker::FDelegateHandle AdvertTickerHandle;
+	FOnFillAdvert OnFillAdvert;
+	//Tells the sessions of different hosts apart, picked when advertising starts
+	uint64 HostId{ 0 };
+
+	FSocket* QuerySocket{ nullptr };
+	FTSTicker::FDelegateHandle QueryTickerHandle;
+	FLanSessionDiscoveryQuery Query;
+	FOnHostFound OnHostFound;
+	FOnDiscoveryComplete OnComplete;
+	//Replies carry the nonce of the query they answer, replies to older queries are dropped
+	uint32 QueryNonce{ 0 };
+	double QueryStartTime{ 0.0 };
+	double LastQuerySendTime{ 0.0 };
+	double LastReplyTime{ 0.0 };
+	TSet<uint64> RepliedHostIds;
+
+	TArray<uint8> ReceiveBuffer;
+};
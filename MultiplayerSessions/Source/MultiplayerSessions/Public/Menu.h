@@ -1,65 +0,0 @@
-// Fill out your copyright notice in the Description page of Project Settings.
-
-#pragma once
-
-#include "CoreMinimal.h"
-#include "Blueprint/UserWidget.h"
-#include "Interfaces/OnlineSessionInterface.h"
-#include "Menu.generated.h"
-
-class UButton;
-class UMultiplayerSessionsSubsystem;
-
-UCLASS()
-class MULTIPLAYERSESSIONS_API UMenu : public UUserWidget
-{
-	GENERATED_BODY()
-	
-public:
-	UFUNCTION(BlueprintCallable)
-	void MenuSetup(int32 numOfPublicConnections = 4, FString matchType = FString(TEXT("FreeForAll")), FString lobbyPath = FString(TEXT("/Game/ThirdPerson/Maps/Lobby")));
-
-protected:
-	virtual bool Initialize() override;
-	virtual void NativeDestruct() override;
-
-	/*
-	* Callbacks for custom delegates on the MultiplayerSessionsSubsystem
-	*/
-	UFUNCTION()
-	void OnCreateSession(bool bWasSuccessful);
-	void OnFindSessions(const TArray<FOnlineSessionSearchResult>& sessionResults, bool bWasSuccessful);
-	void OnJoinSessions(EOnJoinSessionCompleteResult::Type result);
-	UFUNCTION()
-	void OnDestroySession(bool bWasSuccessful);
-	UFUNCTION()
-	void OnStartSession(bool bWasSuccessful);
-
-private:
-	/*
-	* This UPROPERTY meta will link the button from the widget to this variable
-	* Variable needs the exact same name as the items in the widget blueprint!
-	*/
-	UPROPERTY(meta = (BindWidget))
-	UButton* HostButton;
-
-	UPROPERTY(meta = (BindWidget))
-	UButton* JoinButton;
-
-	UFUNCTION()
-	void HostButtonClicked();
-
-	UFUNCTION()
-	void JoinButtonClicked();
-
-	void MenuTearDown();
-
-	/*
-	* Subsystem designed to handle all online session functionality
-	*/
-	UMultiplayerSessionsSubsystem* MultiplayerSessionsSubSystem;
-
-	int32 NumPublicConnections{ 4 };
-	FString MatchType{ TEXT("FreeForAll") };
-	FString PathToLobby{ TEXT("") };
-};
@@ -0,0 +1,190 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Interfaces/OnlineSessionInterface.h"
+#include "OnlineSessionSettings.h"
+
+/*
+* Settings for the in-process fake session backend
+* Everything is driven by a seeded random stream, so the same config always produces the same results
+*/
+struct MULTIPLAYERSESSIONS_API FMockOnlineSessionConfig
+{
+	//Delay before every async operation completes, in seconds
+	float LatencySeconds{ 0.05f };
+	//Extra random delay added on top of the latency, in seconds
+	float LatencyJitterSeconds{ 0.0f };
+	//Chance (0-1) that an operation completes with a failure
+	float FailureRate{ 0.0f };
+	//Amount of sessions the fake backend holds, a search returns the ones matching its query settings up to MaxSearchResults
+	int32 NumSearchResults{ 100 };
+	//Results added to the search per tick once the latency has passed, 0 adds them all at once
+	int32 ResultsPerTick{ 0 };
+	//Size of the padding attribute added to every search result, to simulate big settings maps
+	int32 PayloadBytes{ 0 };
+	int32 RandomSeed{ 0 };
+	int32 MinPingInMs{ 10 };
+	int32 MaxPingInMs{ 200 };
+	int32 MaxPublicConnections{ 4 };
+	TArray<FString> MatchTypes{ TEXT("FreeForAll") };
+	//Result a failed join reports
+	EOnJoinSessionCompleteResult::Type JoinFailureResult{ EOnJoinSessionCompleteResult::SessionIsFull };
+
+	/*
+	* Reads overrides from the command line
+	* -MockLatency= -MockJitter= -MockFailureRate= -MockResults= -MockResultsPerTick= -MockPayload= -MockSeed= -MockMatchTypes=A,B
+	*/
+	static FMockOnlineSessionConfig FromCommandLine(const TCHAR* commandLine);
+};
+
+/*
+* Session info for sessions created by the fake backend
+*/
+class MULTIPLAYERSESSIONS_API FOnlineSessionInfoMock : public FOnlineSessionInfo
+{
+public:
+	FOnlineSessionInfoMock(const FString& sessionId, const FString& hostAddress);
+
+	virtual const uint8* GetBytes() const override { return nullptr; }
+	virtual int32 GetSize() const override { return sizeof(FOnlineSessionInfoMock); }
+	virtual bool IsValid() const override { return SessionId->IsValid(); }
+	virtual const FUniqueNetId& GetSessionId() const override { return *SessionId; }
+	virtual FString ToString() const override { return SessionId->ToString(); }
+	virtual FString ToDebugString() const override { return FString::Printf(TEXT("SessionId: %s HostAddress: %s"), *SessionId->ToDebugString(), *HostAddress); }
+
+	const FString& GetHostAddress() const { return HostAddress; }
+
+private:
+	FUniqueNetIdRef SessionId;
+	FString HostAddress;
+};
+
+/*
+* Sessions hosted through fake session interfaces, shared between all interfaces pointed at it
+* Lets several game instances in one process find and join each other, e.g. for load tests
+* Game thread only
+*/
+class MULTIPLAYERSESSIONS_API FMockSessionBackend
+{
+public:
+	FString MakeSessionId();
+
+	void AddHostedSession(const FString& sessionId, const FOnlineSession& session);
+	void RemoveHostedSession(const FString& sessionId);
+	bool IsHostedSession(const FString& sessionId) const { return HostedSessions.Contains(sessionId); }
+	int32 GetNumHostedSessions() const { return HostedSessions.Num(); }
+
+	/*
+	* Hosted sessions as search results, with the open slots they have right now
+	*/
+	void GetSearchResults(TArray<FOnlineSessionSearchResult>& outSearchResults) const;
+
+	/*
+	* Takes a slot for a joining player, fails when the session filled up or went away in the meantime
+	*/
+	EOnJoinSessionCompleteResult::Type ReserveSlot(const FString& sessionId);
+	void ReleaseSlot(const FString& sessionId);
+
+private:
+	TMap<FString, FOnlineSession> HostedSessions;
+	int32 NextSessionId{ 0 };
+};
+
+/*
+* In-process fake of the online session interface
+* Completes every operation on the game thread after a configurable latency, without touching the network
+* Point the MultiplayerSessionsSubsystem at it with SetSessionInterfaceOverride, or launch with -MockSessions
+*/
+class MULTIPLAYERSESSIONS_API FMockOnlineSession : public IOnlineSession, public TSharedFromThis<FMockOnlineSession, ESPMode::ThreadSafe>
+{
+public:
+	explicit FMockOnlineSession(const FMockOnlineSessionConfig& config = FMockOnlineSessionConfig());
+	virtual ~FMockOnlineSession();
+
+	const FMockOnlineSessionConfig& GetConfig() const { return Config; }
+	void SetConfig(const FMockOnlineSessionConfig& config);
+
+	/*
+	* Shares hosted sessions with the other interfaces using the same backend
+	* Searches return the advertised sessions of the backend before the generated ones
+	*/
+	void SetBackend(const TSharedPtr<FMockSessionBackend, ESPMode::ThreadSafe>& backend) { Backend = backend; }
+
+	/*
+	* Builds a single fake search result, also used to generate data sets without running a search
+	*/
+	FOnlineSessionSearchResult MakeSearchResult(int32 index) const;
+
+	//IOnlineSession
+	virtual FUniqueNetIdPtr CreateSessionIdFromString(const FString& sessionIdStr) override;
+	virtual FNamedOnlineSession* GetNamedSession(FName sessionName) override;
+	virtual void RemoveNamedSession(FName sessionName) override;
+	virtual EOnlineSessionState::Type GetSessionState(FName sessionName) const override;
+	virtual bool HasPresenceSession() override;
+	virtual bool CreateSession(int32 hostingPlayerNum, FName sessionName, const FOnlineSessionSettings& newSessionSettings) override;
+	virtual bool CreateSession(const FUniqueNetId& hostingPlayerId, FName sessionName, const FOnlineSessionSettings& newSessionSettings) override;
+	virtual bool StartSession(FName sessionName) override;
+	virtual bool UpdateSession(FName sessionName, FOnlineSessionSettings& updatedSessionSettings, bool bShouldRefreshOnlineData = true) override;
+	virtual bool EndSession(FName sessionName) override;
+	virtual bool DestroySession(FName sessionName, const FOnDestroySessionCompleteDelegate& completionDelegate = FOnDestroySessionCompleteDelegate()) override;
+	virtual bool IsPlayerInSession(FName sessionName, const FUniqueNetId& uniqueId) override;
+	virtual bool StartMatchmaking(const TArray<FUniqueNetIdRef>& localPlayers, FName sessionName, const FOnlineSessionSettings& newSessionSettings, TSharedRef<FOnlineSessionSearch>& searchSettings) override;
+	virtual bool CancelMatchmaking(int32 searchingPlayerNum, FName sessionName) override;
+	virtual bool CancelMatchmaking(const FUniqueNetId& searchingPlayerId, FName sessionName) override;
+	virtual bool FindSessions(int32 searchingPlayerNum, const TSharedRef<FOnlineSessionSearch>& searchSettings) override;
+	virtual bool FindSessions(const FUniqueNetId& searchingPlayerId, const TSharedRef<FOnlineSessionSearch>& searchSettings) override;
+	virtual bool FindSessionById(const FUniqueNetId& searchingUserId, const FUniqueNetId& sessionId, const FUniqueNetId& friendId, const FOnSingleSessionResultCompleteDelegate& completionDelegate) override;
+	virtual bool CancelFindSessions() override;
+	virtual bool PingSearchResults(const FOnlineSessionSearchResult& searchResult) override;
+	virtual bool JoinSession(int32 playerNum, FName sessionName, const FOnlineSessionSearchResult& desiredSession) override;
+	virtual bool JoinSession(const FUniqueNetId& playerId, FName sessionName, const FOnlineSessionSearchResult& desiredSession) override;
+	virtual bool FindFriendSession(int32 localUserNum, const FUniqueNetId& friendId) override;
+	virtual bool FindFriendSession(const FUniqueNetId& localUserId, const FUniqueNetId& friendId) override;
+	virtual bool FindFriendSession(const FUniqueNetId& localUserId, const TArray<FUniqueNetIdRef>& friendList) override;
+	virtual bool SendSessionInviteToFriend(int32 localUserNum, FName sessionName, const FUniqueNetId& friendId) override;
+	virtual bool SendSessionInviteToFriend(const FUniqueNetId& localUserId, FName sessionName, const FUniqueNetId& friendId) override;
+	virtual bool SendSessionInviteToFriends(int32 localUserNum, FName sessionName, const TArray<FUniqueNetIdRef>& friends) override;
+	virtual bool SendSessionInviteToFriends(const FUniqueNetId& localUserId, FName sessionName, const TArray<FUniqueNetIdRef>& friends) override;
+	virtual bool GetResolvedConnectString(FName sessionName, FString& connectInfo, FName portType = NAME_GamePort) override;
+	virtual bool GetResolvedConnectString(const FOnlineSessionSearchResult& searchResult, FName portType, FString& connectInfo) override;
+	virtual FOnlineSessionSettings* GetSessionSettings(FName sessionName) override;
+	virtual bool RegisterPlayer(FName sessionName, const FUniqueNetId& playerId, bool bWasInvited) override;
+	virtual bool RegisterPlayers(FName sessionName, const TArray<FUniqueNetIdRef>& players, bool bWasInvited = false) override;
+	virtual bool UnregisterPlayer(FName sessionName, const FUniqueNetId& playerId) override;
+	virtual bool UnregisterPlayers(FName sessionName, const TArray<FUniqueNetIdRef>& players) override;
+	virtual void RegisterLocalPlayer(const FUniqueNetId& playerId, FName sessionName, const FOnRegisterLocalPlayerCompleteDelegate& delegate) override;
+	virtual void UnregisterLocalPlayer(const FUniqueNetId& playerId, FName sessionName, const FOnUnregisterLocalPlayerCompleteDelegate& delegate) override;
+	virtual int32 GetNumSessions() override;
+	virtual void DumpSessionState() override;
+
+protected:
+	virtual FNamedOnlineSession* AddNamedSession(FName sessionName, const FOnlineSessionSettings& sessionSettings) override;
+	virtual FNamedOnlineSession* AddNamedSession(FName sessionName, const FOnlineSession& session) override;
+
+private:
+	/*
+	* Runs the function on the game thread once the simulated latency has passed
+	*/
+	void CompleteAfterLatency(TFunction<void()>&& function);
+	bool RollFailure();
+	//Adds the next batch of results to the current search, returns true while results are still missing
+	bool DeliverSearchResults();
+	void AddHostedSearchResults();
+
+	FMockOnlineSessionConfig Config;
+	//Drives latency and failure rolls, search results use their own stream per index
+	FRandomStream RandomStream;
+
+	TArray<TSharedRef<FNamedOnlineSession>> Sessions;
+	TSharedPtr<FOnlineSessionSearch> CurrentSessionSearch;
+	//Bumped on every search and cancel, so completions of an abandoned search are dropped
+	int32 SearchGeneration{ 0 };
+	int32 NextSearchResultIndex{ 0 };
+
+	TSharedPtr<FMockSessionBackend, ESPMode::ThreadSafe> Backend;
+
+	FUniqueNetIdRef HostUserId;
+	int32 NextSessionId{ 0 };
+};
@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "MultiplayerSessionsLoadTestCommandlet.generated.h"
+
+class UGameInstance;
+class UMultiplayerSessionsSubsystem;
+
+/*
+* Simulates hosts and clients in one process, every one of them a game instance with its own MultiplayerSessionsSubsystem
+* They all share an in-process fake backend, so clients find and join the hosts without any network
+* Every wave, all clients search and join at the same time and leave again once everyone is done
+*
+* -run=MultiplayerSessionsLoadTest -Clients=100 -Hosts=1 -Slots=<Clients/Hosts> -Waves=3 -MatchType=FreeForAll -Timeout=60 -Report=<path>
+* The -Mock* arguments of FMockOnlineSessionConfig set the simulated latency and failures, -MockResults defaults to 0 here
+*/
+UCLASS()
+class MULTIPLAYERSESSIONS_API UMultiplayerSessionsLoadTestCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UMultiplayerSessionsLoadTestCommandlet();
+
+	virtual int32 Main(const FString& params) override;
+
+private:
+	UMultiplayerSessionsSubsystem* CreateSimulatedInstance(int32 instanceIndex);
+	void DestroySimulatedInstances();
+
+	UPROPERTY()
+	TArray<UGameInstance*> GameInstances;
+};
@@ -4,7 +4,17 @@
 
 #include "CoreMinimal.h"
 #include "Subsystems/GameInstanceSubsystem.h"
+#include "Containers/Ticker.h"
+#include "Async/Future.h"
 #include "Interfaces/OnlineSessionInterface.h"
+#include "SessionSearchIndex.h"
+#include "SessionSearchQuery.h"
+#include "SessionRanking.h"
+#include "SessionLatencyStats.h"
+#include "MultiplayerSessionsTrace.h"
+#include "LanSessionDiscovery.h"
+#include "SessionQosProbe.h"
+#include "Engine/EngineBaseTypes.h"
 #include "MultiplayerSessionsSubsystem.generated.h"
 
 /*
@@ -15,11 +25,67 @@
  */
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FMultiplayerOnCreateSessionComplete, bool, bWasSuccessful);
 DECLARE_MULTICAST_DELEGATE_TwoParams(FMultiplayerOnFindSessionsComplete, const TArray<FOnlineSessionSearchResult>& sessionResults, bool bWasSuccessful);
+DECLARE_MULTICAST_DELEGATE_OneParam(FMultiplayerOnFindSessionsBatch, TArrayView<const FOnlineSessionSearchResult> batch);
 DECLARE_MULTICAST_DELEGATE_OneParam(FMultiplayerOnJoinSessionComplete, EOnJoinSessionCompleteResult::Type result);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FMultiplayerOnDestroySessionComplete, bool, bWasSuccessful);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FMultiplayerOnStartSessionComplete, bool, bWasSuccessful);
 
-UCLASS()
+/*
+* Value the future of FindSessionsAsync resolves to
+*/
+struct FMultiplayerFindSessionsResult
+{
+	TArray<FOnlineSessionSearchResult> SessionResults;
+	bool bWasSuccessful{ false };
+};
+
+/*
+* Where a paginated search picks up
+* Every page is cut from the same backend search, the cursor remembers the search and how many of its results were handed out
+* Start with a default constructed cursor, it runs the search
+*/
+struct FSessionSearchCursor
+{
+	//Search the pages are cut from, unset before the first page
+	TWeakPtr<FOnlineSessionSearch> SessionSearch;
+	//Results of the search the earlier pages handed out
+	int32 Offset{ 0 };
+	bool bEndReached{ false };
+
+	bool HasMorePages() const { return !bEndReached; }
+	int32 GetNumSeenSessions() const { return Offset; }
+};
+
+/*
+* Value the future of FindSessionsPageAsync resolves to
+*/
+struct FMultiplayerFindSessionsPageResult
+{
+	TArray<FOnlineSessionSearchResult> SessionResults;
+	FSessionSearchCursor NextCursor;
+	bool bWasSuccessful{ false };
+};
+
+DECLARE_MULTICAST_DELEGATE_ThreeParams(FMultiplayerOnFindSessionsPageComplete, const TArray<FOnlineSessionSearchResult>& pageResults, const FSessionSearchCursor& nextCursor, bool bWasSuccessful);
+
+/*
+* Session operation the subsystem is busy with
+* Only one runs at a time, the rest waits in the queue
+*/
+UENUM(BlueprintType)
+enum class EMultiplayerSessionState : uint8
+{
+	Idle,
+	Creating,
+	Destroying,
+	Finding,
+	Joining,
+	Starting
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FMultiplayerOnSessionOperationTimedOut, EMultiplayerSessionState operation);
+
+UCLASS(Config = Game)
 class MULTIPLAYERSESSIONS_API UMultiplayerSessionsSubsystem : public UGameInstanceSubsystem
 {
 	GENERATED_BODY()
@@ -27,21 +93,180 @@ class MULTIPLAYERSESSIONS_API UMultiplayerSessionsSubsystem : public UGameInstan
 public:
 	UMultiplayerSessionsSubsystem();
 
+	virtual void Initialize(FSubsystemCollectionBase& collection) override;
+	virtual void Deinitialize() override;
+
 	/*
 	* To handle session functionality. Menu class will call these.
+	* CreateSession fails for match types that are not in the MatchTypeNames config
 	*/
 	void CreateSession(int32 numPublicConnections, FString matchType);
 	void FindSessions(int32 maxSearchResults);
+	/*
+	* Filtered search, the match type and attribute predicates of the query are evaluated by the backend
+	*/
+	void FindSessions(const FSessionSearchQuery& query);
 	void JoinsSession(const FOnlineSessionSearchResult& result);
 	void DestroySession();
 	void StartSession();
 
+	/*
+	* Streaming search
+	* Broadcasts MultiplayerOnFindSessionsBatch every tick new results came in from the backend
+	* Stops the search as soon as earlyExitMatchCount results with the match type of the query are found (0 waits for the full search)
+	* MultiplayerOnFindSessionsComplete is broadcast at the end with everything found so far
+	* The operation is over at the early exit either way, on backends that can't cancel a search the rest of it completes in the background
+	* and only fills the cache, searches queued in the meantime wait for it
+	*/
+	void FindSessionsStreaming(const FSessionSearchQuery& query, int32 earlyExitMatchCount = 1);
+
+	/*
+	* Paginated search
+	* The first page runs one streaming search (or takes the cached one), every following page is cut from that same search
+	* A page is broadcast with MultiplayerOnFindSessionsPageComplete as soon as the search found pageSize more sessions, or completed,
+	* together with the cursor of the next page, pass that one back in for more
+	* The MaxSearchResults of the query caps all pages together
+	* Every page ranks everything found so far, so GetBestSession is the best session of all pages up to this one
+	* Once no more pages are needed, CancelFindSessions stops the rest of the search, the ranking stays
+	*/
+	void FindSessionsPage(const FSessionSearchQuery& query, int32 pageSize, const FSessionSearchCursor& cursor = FSessionSearchCursor());
+
+	/*
+	* Points the subsystem at a different session interface, e.g. an FMockOnlineSession for testing without network
+	* Passing nullptr goes back to the session interface of the online subsystem
+	*/
+	void SetSessionInterfaceOverride(IOnlineSessionPtr sessionInterface);
+	/*
+	* Session interface of the online subsystem for the world of the owning game instance, or the override
+	* Bound on first use, so every PIE or simulated client in the process gets its own
+	*/
+	IOnlineSessionPtr GetSessionInterface();
+	/*
+	* Address to travel to for the joined session
+	* Sessions found by fast LAN discovery have no backend session, their address comes from the discovery reply
+	* DestroySession leaves such a session without asking the backend, and the address is forgotten
+	*/
+	bool GetResolvedConnectString(FString& outConnectString);
+
+	/*
+	* Dedicated server hosting
+	* Sessions created on a dedicated server (or with bHostAsDedicatedServer) are advertised under the server identity, without presence or lobbies
+	* Clients find them with FSessionSearchQuery::bDedicatedServers
+	* Launch a server with -HostSession [-SessionConnections=16] [-SessionMatchType=FreeForAll] to create and start its session once the map is loaded
+	*/
+	bool IsDedicatedServerHost() const;
+	bool IsSessionInterfaceOverridden() const { return bSessionInterfaceOverridden; }
+
+	/*
+	* Search result cache
+	* FindSessions hands back cached results right away while they are younger than SearchCacheMaxStaleSeconds
+	* Results older than SearchCacheTimeToLive are refreshed in the background, without broadcasting again
+	*/
+	void SetSearchCacheTimeToLive(float timeToLiveSeconds, float maxStaleSeconds);
+	void InvalidateSearchCache();
+	bool IsSearchInProgress() const;
+
+	/*
+	* Prefetch
+	* Keeps the search cache warm in the background, so a FindSessions covered by the query is answered right away
+	* Refreshes every SearchPrefetchIntervalSeconds, only when no other session operation is running or queued
+	* Prefetched searches never broadcast
+	*/
+	void StartSearchPrefetch(const FSessionSearchQuery& query);
+	void StopSearchPrefetch();
+	bool IsPrefetchingSearch() const { return SearchPrefetchTickerHandle.IsValid(); }
+
+	/*
+	* Map preload
+	* Starts loading the map package in the background, so travel after a create or join finds it in memory
+	* The package is held until the next map finished loading, ReleasePreloadedMap or Deinitialize
+	* Ignored in PIE, which travels to duplicated packages
+	*/
+	void PreloadMap(const FString& mapPath);
+	void ReleasePreloadedMap();
+	bool IsMapPreloaded() const { return PreloadedMapPackage != nullptr; }
+
+	/*
+	* Duration of every Create, Find, Join, Destroy and Start from the moment it runs until its delegate is broadcast
+	* Whoever travels times ResolveConnectString and starts Travel, Travel ends when the new map finished loading
+	* Dump with the MultiplayerSessions.DumpLatencyStats console command, or watch "stat MultiplayerSessions"
+	*/
+	FSessionLatencyStats& GetLatencyStats() { return LatencyStats; }
+	const FSessionLatencyStats& GetLatencyStats() const { return LatencyStats; }
+
+	/*
+	* Index over the results that were handed out last, bucketed by the IndexedSearchKeys
+	* References into it stay valid until the next search completes
+	*/
+	const FSessionSearchIndex& GetSearchIndex() const { return SearchIndex; }
+
+	/*
+	* Best candidates of the last search, ranked by ping, fill, build and host reliability, best first
+	* Filled in before MultiplayerOnFindSessionsComplete is broadcast
+	*/
+	const TArray<FRankedSession>& GetRankedSessions() const { return RankedSessions; }
+	//Search the ResultIndex of the ranked sessions points into, a new search keeps the old ranks until it is prepared
+	TSharedPtr<FOnlineSessionSearch> GetRankedSessionSearch() const { return RankedSessionSearch.Pin(); }
+	const FOnlineSessionSearchResult* GetBestSession() const;
+	FSessionRanker& GetSessionRanker() { return SessionRanker; }
+
+	/*
+	* Joins the best ranked session of the last search
+	* When that session turns out to be full or gone, the next candidate is tried right away, up to MaxJoinAttempts
+	* MultiplayerOnJoinSessionComplete is only broadcast for the final attempt
+	* With bQosProbeBeforeJoin the best QosProbeCandidates are probed first, and ranked again with the round trip time
+	* and jitter we measured instead of the ping the backend reported
+	*/
+	void JoinBestSession();
+
+	/*
+	* Operation queue
+	* Create, Find, Join, Destroy and Start run one after the other, a call made while another one is running waits for it
+	* A call replaces a queued call of the same kind instead of queueing twice, the latest parameters win
+	* Finds are single flight instead: a Find covered by the running or a queued search shares that search and its results,
+	* a queued search the new Find covers is widened to it, and only a Find neither covers queues a search of its own
+	*/
+	EMultiplayerSessionState GetSessionState() const { return CurrentState; }
+	int32 GetNumQueuedOperations() const { return QueuedOperations.Num(); }
+	//Drops the queued operations, the running one still completes
+	//Futures of the dropped operations resolve as failed
+	void CancelQueuedOperations();
+	/*
+	* Stops the running search and drops the queued ones
+	* Their callers get MultiplayerOnFindSessionsComplete without results and bWasSuccessful false
+	*/
+	void CancelFindSessions();
+
+	/*
+	* Watchdog
+	* An operation the backend doesn't answer within its timeout (CreateSessionTimeoutSeconds and friends) is abandoned,
+	* a late answer is ignored
+	* MultiplayerOnSessionOperationTimedOut is broadcast first, then the delegate of the operation with a failed result
+	*/
+	FMultiplayerOnSessionOperationTimedOut MultiplayerOnSessionOperationTimedOut;
+
+	/*
+	* Future based versions of the calls above, for chaining steps with Then/Next instead of binding the delegates
+	* A future resolves with the same value the matching delegate is broadcast with, continuations run on the game thread
+	* Futures of coalesced calls all resolve with the result of the call that ran
+	* On Deinitialize, an interface override or CancelQueuedOperations, pending futures resolve as failed
+	*/
+	TFuture<bool> CreateSessionAsync(int32 numPublicConnections, FString matchType);
+	TFuture<FMultiplayerFindSessionsResult> FindSessionsAsync(const FSessionSearchQuery& query);
+	TFuture<FMultiplayerFindSessionsPageResult> FindSessionsPageAsync(const FSessionSearchQuery& query, int32 pageSize, const FSessionSearchCursor& cursor = FSessionSearchCursor());
+	TFuture<EOnJoinSessionCompleteResult::Type> JoinSessionAsync(const FOnlineSessionSearchResult& result);
+	TFuture<EOnJoinSessionCompleteResult::Type> JoinBestSessionAsync();
+	TFuture<bool> DestroySessionAsync();
+	TFuture<bool> StartSessionAsync();
+
 	/*
 	* Custom delegates for the Menu class to bind callbacks to
 	* Menu needs this information to know when the player moves on, to display different things
 	*/
 	FMultiplayerOnCreateSessionComplete MultiplayerOnCreateSessionComplete;
 	FMultiplayerOnFindSessionsComplete MultiplayerOnFindSessionsComplete;
+	FMultiplayerOnFindSessionsBatch MultiplayerOnFindSessionsBatch;
+	FMultiplayerOnFindSessionsPageComplete MultiplayerOnFindSessionsPageComplete;
 	FMultiplayerOnJoinSessionComplete MultiplayerOnJoinSessionComplete;
 	FMultiplayerOnDestroySessionComplete MultiplayerOnDestroySessionComplete;
 	FMultiplayerOnStartSessionComplete MultiplayerOnStartSessionComplete;
@@ -58,9 +283,163 @@ protected:
 	void OnStartSessionComplete(FName sessionName, bool bWasSuccessful);
 
 private:
+	struct FQueuedSessionOperation
+	{
+		//Shows up in the trace events of the operation
+		uint32 Id{ 0 };
+		EMultiplayerSessionState State{ EMultiplayerSessionState::Idle };
+		TFunction<void()> Start;
+
+		//Finding only, kept so later Finds can share the search
+		FSessionSearchQuery SearchQuery;
+		bool bStreaming{ false };
+		int32 EarlyExitMatchCount{ 0 };
+		bool bSilent{ false };
+	};
+
+	//Future of a FindSessionsAsync call, resolved by the search with that operation id
+	struct FFindSessionsPromise
+	{
+		uint32 SearchId{ 0 };
+		TPromise<FMultiplayerFindSessionsResult> Promise;
+	};
+
+	//Future of a FindSessionsPageAsync call, resolved once the search with that operation id found enough for the page, or completed
+	struct FFindSessionsPagePromise
+	{
+		uint32 SearchId{ 0 };
+		int32 Offset{ 0 };
+		int32 PageSize{ 1 };
+		FSessionSearchQuery Query;
+		TPromise<FMultiplayerFindSessionsPageResult> Promise;
+	};
+
+	void EnqueueOperation(EMultiplayerSessionState state, TFunction<void()>&& start);
+	void StartNextOperation();
+	//Called once the running operation broadcast its result
+	void FinishOperation();
+	//Starts the timeout of the running operation
+	void ArmOperationDeadline();
+	float GetOperationTimeout(EMultiplayerSessionState state) const;
+	bool TickOperationWatchdog(float deltaTime);
+	void TimeOutOperation();
+	/*
+	* Stops the running search on the backend and tells its callers it failed
+	* Silent searches only broadcast with bForceBroadcast
+	*/
+	void AbandonRunningSearch(bool bForceBroadcast);
+	/*
+	* Detached search
+	* A search the backend couldn't cancel keeps running after its operation is over
+	* Its results only go to the cache, the next search waits for it, or until the watchdog drops it after FindSessionsTimeoutSeconds
+	*/
+	void DetachRunningSearch();
+	void CompleteDetachedSearch(bool bWasSuccessful);
+	void DropDetachedSearch();
+	void SetFindSessionsPromiseValues(uint32 searchId, const FMultiplayerFindSessionsResult& result);
+	/*
+	* Hands out the pages waiting for searchId that sessionSearch has enough results for, or all of them once the search is done
+	* A null search fails them
+	*/
+	void ResolveSearchPages(uint32 searchId, const TSharedPtr<FOnlineSessionSearch>& sessionSearch, bool bSearchDone);
+
+	/*
+	* Fast LAN discovery, replaces the LAN beacon of the NULL online subsystem when bFastLanDiscovery is set
+	*/
+	bool ShouldUseLanDiscovery() const;
+	FLanSessionDiscovery& GetLanDiscovery();
+	bool StartLanDiscoverySearch(const FSessionSearchQuery& query);
+	void OnLanHostFound(const FOnlineSessionSearchResult& result);
+	void OnLanDiscoveryComplete(bool bWasSuccessful);
+	bool FillLanAdvert(FLanSessionAdvert& outAdvert);
+	//Cancels the search on whichever backend runs it, returns false when the backend can't cancel
+	bool CancelBackendSearch();
+	bool IsOperationPending(EMultiplayerSessionState state) const;
+
+	/*
+	* QoS probing of the best candidates before JoinBestSession commits to one
+	* Returns false when there is nothing worth probing, the join goes ahead right away then
+	*/
+	bool StartQosProbe();
+	void OnQosProbeComplete(const TArray<FSessionQosMeasurement>& measurements, TArray<FString> sessionIds);
+	//Address of the QoS responder of the host, false when the backend can't tell where the host is
+	bool GetQosProbeAddress(const FOnlineSessionSearchResult& result, FString& outAddress);
+	//Joins the first of RankedSessions, falling back to the next ones
+	void JoinBestRankedSession();
+
+	/*
+	* Broadcast the custom delegate and resolve the futures waiting for it
+	*/
+	void BroadcastCreateSessionComplete(bool bWasSuccessful);
+	//Futures of searchId are resolved, 0 resolves none
+	void BroadcastFindSessionsComplete(const TArray<FOnlineSessionSearchResult>& sessionResults, bool bWasSuccessful, uint32 searchId);
+	void BroadcastJoinSessionComplete(EOnJoinSessionCompleteResult::Type result);
+	void BroadcastDestroySessionComplete(bool bWasSuccessful);
+	void BroadcastStartSessionComplete(bool bWasSuccessful);
+	void TraceOperation(EMultiplayerSessionState kind, ESessionTraceStage stage, FName sessionName, int32 resultCount, bool bWasSuccessful) const;
+	//Resolves every pending future as failed, except the ones waiting for stateToKeep
+	void FailPendingFutures(EMultiplayerSessionState stateToKeep);
+
+	//Drops the timing of the running operation, when it won't complete normally
+	void AbortOperationPhase();
+	void OnPostLoadMap(UWorld* pLoadedWorld);
+	void OnMapPreloaded(const FName& packageName, UPackage* pPackage, EAsyncLoadingResult::Type result);
+	void OnTravelFailure(UWorld* pWorld, ETravelFailure::Type failureType, const FString& errorString);
+	void OnNetworkFailure(UWorld* pWorld, UNetDriver* pNetDriver, ENetworkFailure::Type failureType, const FString& errorString);
+
+	/*
+	* Start the operation once it is its turn in the queue
+	*/
+	void StartCreateSession(int32 numPublicConnections, const FString& matchType, bool bDestroyedExistingSession);
+	//pPromise and pPagePromise are resolved by the search that answers this call, whether it comes from the cache or a shared search
+	void FindSessionsInternal(const FSessionSearchQuery& query, bool bStreaming, int32 earlyExitMatchCount, TPromise<FMultiplayerFindSessionsResult>* pPromise = nullptr, FFindSessionsPagePromise* pPagePromise = nullptr);
+	/*
+	* Queues a search, or joins the running or a queued one that covers the query
+	* Returns the operation id of the search that will answer
+	*/
+	uint32 EnqueueSearch(const FSessionSearchQuery& query, bool bStreaming, int32 earlyExitMatchCount, bool bSilent, TPromise<FMultiplayerFindSessionsResult>* pPromise, FFindSessionsPagePromise* pPagePromise = nullptr);
+	//Registers the futures of a Find with the search that answers it, before that search can complete
+	void AddSearchPromises(uint32 searchId, TPromise<FMultiplayerFindSessionsResult>* pPromise, FFindSessionsPagePromise* pPagePromise);
+	void SetSearchStart(FQueuedSessionOperation& operation);
+	void StartFindSessions(const FSessionSearchQuery& query, bool bStreaming, int32 earlyExitMatchCount, bool bSilent);
+	void StartDestroySession();
+	void StartSessionInternal();
+	bool TickSearchPrefetch(float deltaTime);
+
+	bool StartSessionSearch(const FSessionSearchQuery& query);
+	bool CanUseSearchCache(const FSessionSearchQuery& query) const;
+	//Checks the results of LastSessionSearch past NumFilteredResults against the query, before they are batched, paged or indexed
+	void FilterNewSearchResults();
+	/*
+	* Indexes and ranks results before they are handed out
+	*/
+	void PrepareSearchResults(const TSharedPtr<FOnlineSessionSearch>& sessionSearch, const FSessionSearchQuery& query);
+
+	void JoinSessionInternal(const FOnlineSessionSearchResult& result);
+	bool TryJoinNextCandidate();
+
+	/*
+	* Polls the running search for results the backend added since the last tick
+	*/
+	bool TickStreamingSearch(float deltaTime);
+	void BroadcastStreamedResults();
+	void StopStreamingSearch();
+
+	void ClearSessionInterfaceDelegates();
+	//Binds OnlineSessionInterface to the online subsystem of our world if it is not bound yet, returns false when there is none
+	bool ResolveSessionInterface();
+	//If the subsystem is null, it is a LAN match
+	bool IsLanMatch() const;
+	//Null when there is no local player, e.g. on a headless build box
+	FUniqueNetIdPtr GetLocalUserId() const;
+
 	IOnlineSessionPtr OnlineSessionInterface;
+	//Name of the online subsystem OnlineSessionInterface was taken from, None while unbound or overridden
+	FName OnlineSubsystemName;
+	bool bSessionInterfaceOverridden{ false };
 	TSharedPtr<FOnlineSessionSettings> LastSessionSettings;
 	TSharedPtr<FOnlineSessionSearch> LastSessionSearch;
+	FSessionSearchQuery LastSearchQuery;
 
 	/*
 	* To add to the online session interface delegate list.
@@ -77,7 +456,149 @@ private:
 	FOnStartSessionCompleteDelegate StartSessionCompleteDelegate;
 	FDelegateHandle StartSessionCompleteDelegateHandle;
 
-	bool bCreateSessionOnDestroy{ false };
-	int32 LastNumPublicConnections;
-	FString LastMatchType;
+	/*
+	* Results of the last successful search, kept alive between searches
+	* Setting the time to live to 0 disables the cache
+	*/
+	UPROPERTY(Config)
+	float SearchCacheTimeToLive{ 15.0f };
+	UPROPERTY(Config)
+	float SearchCacheMaxStaleSeconds{ 60.0f };
+
+	//Advertised settings keys the search index buckets results by
+	UPROPERTY(Config)
+	TArray<FName> IndexedSearchKeys;
+
+	//Match types sessions can be hosted with, every build that should find the others needs the same list in the same order
+	//Empty keeps FreeForAll, TeamDeathmatch and CaptureTheFlag
+	UPROPERTY(Config)
+	TArray<FString> MatchTypeNames;
+	FSessionSearchIndex SearchIndex;
+
+	UPROPERTY(Config)
+	FSessionRankingWeights RankingWeights;
+	//Amount of candidates the ranking keeps
+	UPROPERTY(Config)
+	int32 RankingTopK{ 16 };
+	FSessionRanker SessionRanker;
+	TArray<FRankedSession> RankedSessions;
+	TWeakPtr<FOnlineSessionSearch> RankedSessionSearch;
+	FString JoiningSessionId;
+
+	//Join attempts JoinBestSession makes before giving up, including the first one
+	UPROPERTY(Config)
+	int32 MaxJoinAttempts{ 3 };
+	//Position in RankedSessions to try next, INDEX_NONE when not falling back
+	int32 NextJoinCandidate{ INDEX_NONE };
+	int32 JoinAttemptsLeft{ 0 };
+
+	//Seconds the backend gets to answer an operation before the watchdog gives up on it, 0 waits forever
+	//Every JoinBestSession attempt gets the full join timeout
+	UPROPERTY(Config)
+	float CreateSessionTimeoutSeconds{ 30.0f };
+	UPROPERTY(Config)
+	float FindSessionsTimeoutSeconds{ 60.0f };
+	UPROPERTY(Config)
+	float JoinSessionTimeoutSeconds{ 30.0f };
+	UPROPERTY(Config)
+	float DestroySessionTimeoutSeconds{ 30.0f };
+	UPROPERTY(Config)
+	float StartSessionTimeoutSeconds{ 30.0f };
+	FTSTicker::FDelegateHandle OperationWatchdogTickerHandle;
+	//0 when the running operation has no deadline
+	double OperationDeadline{ 0.0 };
+
+	TSharedPtr<FOnlineSessionSearch> CachedSessionSearch;
+	FSessionSearchQuery CachedSearchQuery;
+	double CachedSearchTime{ 0.0 };
+	//When set, the next search completion only updates the cache, the caller already got results
+	bool bRefreshingSearchCache{ false };
+	TSharedPtr<FOnlineSessionSearch> DetachedSessionSearch;
+	FSessionSearchQuery DetachedSearchQuery;
+	double DetachedSearchDeadline{ 0.0 };
+
+	UPROPERTY(Config)
+	float SearchPrefetchIntervalSeconds{ 10.0f };
+
+	//Host like a dedicated server even when not running as one, e.g. a headless game build
+	UPROPERTY(Config)
+	bool bHostAsDedicatedServer{ false };
+	UPROPERTY(Config)
+	int32 DedicatedServerPublicConnections{ 16 };
+	UPROPERTY(Config)
+	FString DedicatedServerMatchType{ TEXT("FreeForAll") };
+
+	/*
+	* LAN matches are found through FLanSessionDiscovery instead of the LAN beacon of the NULL online subsystem
+	* Hosts and clients both need it on, the NULL beacon doesn't answer discovery queries
+	*/
+	UPROPERTY(Config)
+	bool bFastLanDiscovery{ false };
+	UPROPERTY(Config)
+	FString LanDiscoveryGroup{ TEXT("239.255.77.77") };
+	UPROPERTY(Config)
+	int32 LanDiscoveryPort{ 14020 };
+	UPROPERTY(Config)
+	float LanDiscoveryTimeoutSeconds{ 0.5f };
+	//A search ends once no new host replied for this long
+	UPROPERTY(Config)
+	float LanDiscoveryQuietSeconds{ 0.05f };
+	TUniquePtr<FLanSessionDiscovery> LanDiscovery;
+	//Host address of a session joined through LAN discovery, empty otherwise
+	FString JoinedLanHostAddress;
+
+	/*
+	* QoS probes before JoinBestSession, only hosts with bQosResponder answer them
+	* Hosts without an ip the client can reach (relayed backends) keep the ping the backend reported
+	*/
+	UPROPERTY(Config)
+	bool bQosProbeBeforeJoin{ false };
+	UPROPERTY(Config)
+	int32 QosProbeCandidates{ 4 };
+	UPROPERTY(Config)
+	int32 QosProbesPerCandidate{ 5 };
+	UPROPERTY(Config)
+	float QosProbeTimeoutSeconds{ 0.3f };
+	//Hosts answer QoS probes on QosPort while their session exists
+	UPROPERTY(Config)
+	bool bQosResponder{ false };
+	UPROPERTY(Config)
+	int32 QosPort{ 14021 };
+	FSessionQosProber QosProber;
+	TUniquePtr<FSessionQosResponder> QosResponder;
+	//Join operation the running probe belongs to, its results are dropped once that join is over
+	uint32 QosProbeOperationId{ 0 };
+	FTSTicker::FDelegateHandle SearchPrefetchTickerHandle;
+	FSessionSearchQuery SearchPrefetchQuery;
+
+	//Keeps the preloaded map from being garbage collected before we travel to it
+	UPROPERTY(Transient)
+	UPackage* PreloadedMapPackage{ nullptr };
+	//Package being preloaded or held, None when there is none
+	FName PreloadMapName;
+	double PreloadMapStartTime{ 0.0 };
+
+	FTSTicker::FDelegateHandle StreamingSearchTickerHandle;
+	bool bStreamingSearch{ false };
+	int32 StreamingEarlyExitMatchCount{ 0 };
+	int32 NumStreamedResults{ 0 };
+	//Results of LastSessionSearch already checked against the query, they are never removed afterwards
+	int32 NumFilteredResults{ 0 };
+
+	EMultiplayerSessionState CurrentState{ EMultiplayerSessionState::Idle };
+	uint32 CurrentOperationId{ 0 };
+	uint32 NextOperationId{ 1 };
+	TArray<FQueuedSessionOperation> QueuedOperations;
+
+	FSessionLatencyStats LatencyStats;
+	FDelegateHandle PostLoadMapDelegateHandle;
+	FDelegateHandle TravelFailureDelegateHandle;
+	FDelegateHandle NetworkFailureDelegateHandle;
+
+	TArray<TPromise<bool>> CreateSessionPromises;
+	TArray<FFindSessionsPromise> FindSessionsPromises;
+	TArray<FFindSessionsPagePromise> FindSessionsPagePromises;
+	TArray<TPromise<EOnJoinSessionCompleteResult::Type>> JoinSessionPromises;
+	TArray<TPromise<bool>> DestroySessionPromises;
+	TArray<TPromise<bool>> StartSessionPromises;
 };
@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Trace/Trace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+/*
+* Unreal Insights channel for session operations, enable with -trace=cpu,MultiplayerSessions
+* Works the same on headless servers, record to a file with -tracefile=
+*/
+UE_TRACE_CHANNEL_EXTERN(MultiplayerSessionsChannel, MULTIPLAYERSESSIONS_API);
+
+//CPU scope that only shows up when the MultiplayerSessions channel is enabled
+#define MULTIPLAYERSESSIONS_TRACE_SCOPE(Name) TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Name, MultiplayerSessionsChannel)
+
+/*
+* Point in the life of a session operation an event is sent for
+*/
+enum class ESessionTraceStage : uint8
+{
+	//Added to the queue
+	Queued,
+	//Shares a queued or running operation of the same kind instead of queueing its own
+	Coalesced,
+	//Left the queue and called the backend
+	Started,
+	//Completion callback of the backend arrived
+	Callback,
+	//Result broadcast to the listeners
+	Completed,
+	//Dropped on request before the backend answered
+	Cancelled,
+	//The backend didn't answer before the deadline of the operation
+	TimedOut
+};
+
+struct MULTIPLAYERSESSIONS_API FMultiplayerSessionsTrace
+{
+	/*
+	* Sends a MultiplayerSessions.Operation event
+	* operationKind is the EMultiplayerSessionState of the operation, resultCount the amount of search results or -1
+	*/
+	static void OutputOperation(uint32 operationId, uint8 operationKind, ESessionTraceStage stage, FName sessionName, int32 resultCount, bool bWasSuccessful);
+};
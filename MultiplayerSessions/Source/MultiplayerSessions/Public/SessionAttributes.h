@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "OnlineSessionSettings.h"
+
+//Settings keys the plugin advertises, every session of ours has them
+#define SESSION_ATTRIBUTE_MATCHTYPE FName(TEXT("MatchType"))
+
+/*
+* Typed schema of the settings the plugin advertises with every session
+* Encoding and decoding only happen here, the rest of the plugin works with the typed fields
+* The match type goes out as a single packed int32: schema version in the top 8 bits, the position in MatchTypeNames in the low 24 bits
+* Searches compare ints instead of strings, and sessions advertised with another schema version never match a search
+* Bump SchemaVersion whenever the encoding changes
+*/
+struct MULTIPLAYERSESSIONS_API FSessionAttributes
+{
+	static constexpr uint8 SchemaVersion = 2;
+
+	//Build every session of ours is advertised with, searches and LAN queries skip sessions of other builds
+	//Hosts of different values never see each other, so this is the only place it is defined
+	static constexpr int32 BuildUniqueId = 1;
+
+	/*
+	* Match types sessions can be advertised with, FreeForAll, TeamDeathmatch and CaptureTheFlag unless a project sets its own
+	* The subsystem sets it from its MatchTypeNames config
+	* Only append to the table, the position is what goes out, so it has to mean the same in every build that finds the others
+	*/
+	static void SetMatchTypeNames(const TArray<FString>& matchTypeNames);
+	static const TArray<FString>& GetMatchTypeNames();
+
+	//Packed value no session advertises, searches for match types that are not in the table use it
+	static constexpr int32 UnknownPackedMatchType = -1;
+
+	uint8 Version{ SchemaVersion };
+	//Position in MatchTypeNames, INDEX_NONE when there is none
+	int32 MatchType{ INDEX_NONE };
+
+	//False when the match type is not in MatchTypeNames
+	static bool Make(const FString& matchType, FSessionAttributes& outAttributes);
+
+	void WriteTo(FOnlineSessionSettings& settings) const;
+	//False when the settings carry no attributes, or ones of another schema version
+	static bool Read(const FOnlineSessionSettings& settings, FSessionAttributes& outAttributes);
+
+	bool HasMatchType(const FString& matchType) const { return MatchType != INDEX_NONE && MatchType == FindMatchType(matchType); }
+	//Null for match types appended to the table by a newer build, only valid until the table is set again
+	const TCHAR* GetMatchTypeName() const;
+
+	int32 Pack() const;
+	static FSessionAttributes Unpack(int32 packedValue);
+
+	//Position of the match type in MatchTypeNames, INDEX_NONE when it is not in there
+	static int32 FindMatchType(const FString& matchType);
+	//Value sessions with the match type advertise under SESSION_ATTRIBUTE_MATCHTYPE, UnknownPackedMatchType for match types not in the table
+	static int32 PackMatchType(const FString& matchType);
+	//Value the search index buckets sessions with the match type under
+	static FVariantData GetMatchTypeIndexValue(const FString& matchType) { return FVariantData(PackMatchType(matchType)); }
+};
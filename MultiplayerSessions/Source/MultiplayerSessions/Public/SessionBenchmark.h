@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SessionLatencyStats.h"
+
+class UMultiplayerSessionsSubsystem;
+
+struct MULTIPLAYERSESSIONS_API FSessionBenchmarkSettings
+{
+	//Timed runs per benchmark
+	int32 Iterations{ 20 };
+	//A find benchmark runs for every result count
+	TArray<int32> FindResultCounts{ 10, 1000, 10000 };
+	//Results indexed and ranked by the ranking benchmark
+	int32 RankingResultCount{ 10000 };
+	//Page size and page count of the menu benchmark, the defaults of UMenu
+	int32 MenuPageSize{ 50 };
+	int32 MenuMaxPages{ 20 };
+	//Chance a join attempt fails in the failover benchmark, so the next candidate gets tried
+	//Runs where every attempt failed are left out of the timings, but don't count as failures
+	float JoinFailureRate{ 0.5f };
+	//Hosts probed at once by the QoS benchmark, all of them stood in for by one responder on loopback
+	int32 QosProbeTargetCount{ 8 };
+	//Give up on an operation that did not complete after this long
+	float OperationTimeoutSeconds{ 10.0f };
+};
+
+struct MULTIPLAYERSESSIONS_API FSessionBenchmarkResult
+{
+	FString Name;
+	int32 NumFailures{ 0 };
+	FSessionLatencyHistogram Timings;
+};
+
+/*
+* Benchmarks the session subsystem against the in-process fake backend
+* Runs on the game thread and pumps the core ticker itself, so the timings contain the work of the subsystem and not the frame rate
+* The session interface, search cache and prefetch of the subsystem are reset to what they were when done
+*
+* From the console: MultiplayerSessions.Benchmark [Iterations=20] [File=<path>] [Quit]
+* On CI: -nullrhi -ExecCmds="MultiplayerSessions.Benchmark Quit", timings end up in Saved/Benchmarks/MultiplayerSessions.json
+* or the MultiplayerSessions.Benchmark automation test, which writes the same file and fails on failed operations or empty benchmarks
+*/
+class MULTIPLAYERSESSIONS_API FSessionBenchmark
+{
+public:
+	static TArray<FSessionBenchmarkResult> Run(UMultiplayerSessionsSubsystem& subsystem, const FSessionBenchmarkSettings& settings = FSessionBenchmarkSettings());
+
+	//Timings in milliseconds, one object per benchmark
+	static FString ToJson(const TArray<FSessionBenchmarkResult>& results);
+	//Where the console command and the automation test write the json
+	static FString GetDefaultJsonPath();
+};
@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*
+* Steps of the session lifecycle that get timed
+* ResolveConnectString and Travel are timed by whoever travels, the rest by the subsystem
+*/
+enum class ESessionLatencyPhase : uint8
+{
+	Create,
+	Find,
+	Join,
+	Destroy,
+	Start,
+	ResolveConnectString,
+	Travel,
+
+	Num
+};
+
+MULTIPLAYERSESSIONS_API const TCHAR* LexToString(ESessionLatencyPhase phase);
+
+/*
+* Histogram of durations with buckets that grow by a fixed ratio
+* Percentiles are accurate to the bucket width, about 10% of the value
+*/
+class MULTIPLAYERSESSIONS_API FSessionLatencyHistogram
+{
+public:
+	FSessionLatencyHistogram();
+
+	void Add(double seconds);
+	void Reset();
+
+	int32 Num() const { return Count; }
+	double GetMinSeconds() const { return Count > 0 ? MinSeconds : 0.0; }
+	double GetMaxSeconds() const { return MaxSeconds; }
+	double GetMeanSeconds() const { return Count > 0 ? TotalSeconds / Count : 0.0; }
+	/*
+	* Upper bound of the bucket holding the given percentile (0-100), clamped to the max recorded duration
+	*/
+	double GetPercentileSeconds(float percentile) const;
+
+private:
+	static int32 GetBucketIndex(double seconds);
+	static double GetBucketUpperBound(int32 bucketIndex);
+
+	TArray<int32> Buckets;
+	int32 Count{ 0 };
+	double MinSeconds{ 0.0 };
+	double MaxSeconds{ 0.0 };
+	double TotalSeconds{ 0.0 };
+};
+
+/*
+* Per phase timings of the session lifecycle
+* Durations are kept in a histogram per phase and pushed to the MultiplayerSessions stat group ("stat MultiplayerSessions")
+*/
+class MULTIPLAYERSESSIONS_API FSessionLatencyStats
+{
+public:
+	void BeginPhase(ESessionLatencyPhase phase);
+	//Records the time since BeginPhase, returns it or a negative value when the phase was not running
+	double EndPhase(ESessionLatencyPhase phase);
+	//Forgets a running phase without recording it, e.g. when travel failed
+	void AbortPhase(ESessionLatencyPhase phase);
+	bool IsPhaseRunning(ESessionLatencyPhase phase) const;
+
+	void Record(ESessionLatencyPhase phase, double seconds);
+	void Reset();
+
+	const FSessionLatencyHistogram& GetHistogram(ESessionLatencyPhase phase) const;
+
+	//One line per phase with count, mean, p50, p99 and max in milliseconds
+	FString ToString() const;
+
+private:
+	FSessionLatencyHistogram Histograms[(int32)ESessionLatencyPhase::Num];
+	//Start time per running phase, 0 when not running
+	double PhaseStartTimes[(int32)ESessionLatencyPhase::Num]{};
+};
@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include <atomic>
+
+class FSocket;
+class FRunnableThread;
+struct FSessionQosProbeState;
+
+/*
+* Host to probe, the address is ip:port of the QoS responder of the host
+*/
+struct MULTIPLAYERSESSIONS_API FSessionQosTarget
+{
+	FString SessionId;
+	FString Address;
+};
+
+/*
+* What the probes of a single host measured
+*/
+struct MULTIPLAYERSESSIONS_API FSessionQosMeasurement
+{
+	//Median round trip time of the probes that came back
+	float RttMs{ 0.0f };
+	//Mean difference between the round trip times of consecutive probes
+	float JitterMs{ 0.0f };
+	int32 NumSent{ 0 };
+	int32 NumReceived{ 0 };
+
+	//Nothing was sent when the address couldn't be probed, e.g. a relayed connection without an ip
+	bool WasProbed() const { return NumSent > 0; }
+	bool IsReachable() const { return NumReceived > 0; }
+	float GetLossRate() const { return NumSent > 0 ? 1.0f - (float)NumReceived / NumSent : 0.0f; }
+};
+
+struct MULTIPLAYERSESSIONS_API FSessionQosProbeSettings
+{
+	int32 ProbesPerTarget{ 5 };
+	//Time between the probe rounds, every round probes all targets at once
+	float IntervalSeconds{ 0.02f };
+	//Time replies get after the last round was sent
+	float TimeoutSeconds{ 0.5f };
+};
+
+/*
+* Measures round trip time and jitter to a set of hosts with small UDP probes
+* All targets are probed in parallel from one socket on a worker thread, the game thread only hears about the result
+* Hosts answer with an FSessionQosResponder
+*/
+class MULTIPLAYERSESSIONS_API FSessionQosProber
+{
+public:
+	//Measurements are in the order of the targets
+	DECLARE_DELEGATE_OneParam(FOnProbeComplete, const TArray<FSessionQosMeasurement>& /*measurements*/);
+
+	~FSessionQosProber();
+
+	/*
+	* Replaces a running probe, onComplete runs on the game thread
+	* Returns false when there is nothing to probe
+	*/
+	bool StartProbe(const TArray<FSessionQosTarget>& targets, const FSessionQosProbeSettings& settings, FOnProbeComplete&& onComplete);
+	//The worker stops at its next wakeup, onComplete is not called
+	void CancelProbe();
+	bool IsProbing() const;
+
+private:
+	TSharedPtr<FSessionQosProbeState, ESPMode::ThreadSafe> State;
+};
+
+/*
+* Echoes QoS probes back to whoever sent them, on its own thread so a busy game thread doesn't show up as latency
+* Hosts run one while their session exists, tests and benchmarks run one on loopback to stand in for hosts
+*/
+class MULTIPLAYERSESSIONS_API FSessionQosResponder : private FRunnable
+{
+public:
+	//Port 0 binds any free port, GetPort tells which one
+	explicit FSessionQosResponder(int32 port);
+	virtual ~FSessionQosResponder();
+
+	bool StartResponding();
+	void StopResponding();
+	bool IsResponding() const { return Thread != nullptr; }
+	int32 GetPort() const { return BoundPort; }
+
+private:
+	//FRunnable
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+	int32 Port{ 0 };
+	int32 BoundPort{ 0 };
+	FSocket* Socket{ nullptr };
+	FRunnableThread* Thread{ nullptr };
+	std::atomic<bool> bStopping{ false };
+};
@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "OnlineSessionSettings.h"
+#include "Interfaces/OnlineSessionInterface.h"
+#include "SessionQosProbe.h"
+#include "SessionAttributes.h"
+#include "SessionRanking.generated.h"
+
+/*
+* How much each property of a session counts when picking one to join
+* Every term adds to the cost of a session, the session with the lowest cost is the best one
+*/
+USTRUCT()
+struct MULTIPLAYERSESSIONS_API FSessionRankingWeights
+{
+	GENERATED_BODY()
+
+	//Cost per millisecond of ping
+	UPROPERTY(Config)
+	float PingWeight{ 1.0f };
+
+	//Ping used for results the backend couldn't measure
+	UPROPERTY(Config)
+	int32 UnknownPingInMs{ 250 };
+
+	//Cost of a completely empty session, scaled down as the session fills up, so players end up together
+	UPROPERTY(Config)
+	float EmptySessionCost{ 20.0f };
+
+	//Open slots a session needs to be considered at all, e.g. the size of the party
+	UPROPERTY(Config)
+	int32 RequiredOpenSlots{ 1 };
+
+	//Sessions with a different build id are skipped
+	UPROPERTY(Config)
+	bool bRequireMatchingBuild{ true };
+
+	//Cost per failed join on the same host
+	UPROPERTY(Config)
+	float HostFailureCost{ 100.0f };
+
+	//Cost per millisecond of jitter measured by QoS probes
+	UPROPERTY(Config)
+	float JitterWeight{ 2.0f };
+
+	//Cost of a host that answered none of its QoS probes, scaled down by the share of probes that came back
+	UPROPERTY(Config)
+	float PacketLossCost{ 200.0f };
+};
+
+struct FRankedSession
+{
+	//Index into the search results
+	int32 ResultIndex{ INDEX_NONE };
+	float Cost{ 0.0f };
+};
+
+/*
+* Scores search results by latency, fill, build compatibility and host reliability
+* Only the best K candidates are kept, selected with a bounded heap instead of sorting every result
+*/
+class MULTIPLAYERSESSIONS_API FSessionRanker
+{
+public:
+	FSessionRankingWeights Weights;
+	int32 BuildUniqueId{ FSessionAttributes::BuildUniqueId };
+	//Hosts the failure and QoS history is kept for, the ones updated longest ago are forgotten first
+	int32 MaxRememberedHosts{ 256 };
+
+	/*
+	* Cost of joining the session, returns false when the session can't be joined at all
+	*/
+	bool ScoreResult(const FOnlineSessionSearchResult& result, float& outCost) const;
+	/*
+	* Part of the cost that stands for a ping nobody measured, 0 when the backend or a QoS probe measured it
+	* Backends without ping (Steam lobbies, the mock) put every session at UnknownPingInMs
+	*/
+	float GetUnknownPingCost(const FOnlineSessionSearchResult& result) const;
+	//False for the ping backends report when they could not measure it
+	static bool IsPingKnown(int32 pingInMs);
+
+	/*
+	* Ranks the candidates (indices into searchResults) and writes the best topK, best first
+	*/
+	void RankTopK(TArrayView<const FOnlineSessionSearchResult> searchResults, TArrayView<const int32> candidates, int32 topK, TArray<FRankedSession>& outRanked) const;
+	void RankTopK(TArrayView<const FOnlineSessionSearchResult> searchResults, int32 topK, TArray<FRankedSession>& outRanked) const;
+
+	/*
+	* Host reliability, remembered for the lifetime of the ranker
+	* Only failures to reach the host count against it, a full host is healthy and worth trying again later
+	*/
+	void RecordJoinResult(const FString& sessionId, EOnJoinSessionCompleteResult::Type result);
+	void ResetHostHistory() { HostFailures.Reset(); }
+
+	/*
+	* Round trip time and jitter of a host measured by QoS probes
+	* The measured round trip time replaces the ping the backend reported, until the host is measured again
+	*/
+	void SetQosMeasurement(const FString& sessionId, const FSessionQosMeasurement& measurement);
+	void ResetQosMeasurements() { QosMeasurements.Reset(); }
+
+private:
+	void AddCandidate(TArrayView<const FOnlineSessionSearchResult> searchResults, int32 resultIndex, int32 topK, TArray<FRankedSession>& heap) const;
+
+	struct FHostFailures
+	{
+		int32 NumFailures{ 0 };
+		double UpdateTime{ 0.0 };
+	};
+
+	struct FQosRecord
+	{
+		FSessionQosMeasurement Measurement;
+		double UpdateTime{ 0.0 };
+	};
+
+	TMap<FString, FHostFailures> HostFailures;
+	TMap<FString, FQosRecord> QosMeasurements;
+};
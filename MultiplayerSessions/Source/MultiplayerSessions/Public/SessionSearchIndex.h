@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "OnlineSessionSettings.h"
+
+/*
+* Index over the results of a session search
+* Results are bucketed by the values of a few advertised settings keys once, when they come in
+* Lookups hand out references into the search, so nothing gets copied or parsed per query
+*/
+class MULTIPLAYERSESSIONS_API FSessionSearchIndex
+{
+public:
+	/*
+	* Starts indexing a new search, results already in it get indexed on the next Update
+	*/
+	void Reset(const TSharedPtr<FOnlineSessionSearch>& sessionSearch, const TArray<FName>& indexedKeys);
+	//Indexes the results that were added to the search since the last update
+	void Update();
+	void Clear();
+
+	const TSharedPtr<FOnlineSessionSearch>& GetSessionSearch() const { return SessionSearch; }
+	int32 Num() const { return NumIndexedResults; }
+	const FOnlineSessionSearchResult& GetResult(int32 index) const { return SessionSearch->SearchResults[index]; }
+
+	/*
+	* Indices of all results that advertise the value for the key, in search order
+	* The key needs to be one of the indexed keys, otherwise nothing is found
+	*/
+	const TArray<int32>& FindResults(FName key, const FVariantData& value) const;
+	const FOnlineSessionSearchResult* FindFirstResult(FName key, const FVariantData& value) const;
+
+private:
+	//Buckets are keyed by the value itself, ints hash as they are instead of going through a string
+	struct FValueKeyFuncs : TDefaultMapKeyFuncs<FVariantData, TArray<int32>, false>
+	{
+		static uint32 GetKeyHash(const FVariantData& key);
+	};
+	using FValueBuckets = TMap<FVariantData, TArray<int32>, FDefaultSetAllocator, FValueKeyFuncs>;
+
+	TSharedPtr<FOnlineSessionSearch> SessionSearch;
+	TArray<FName> IndexedKeys;
+	TMap<FName, FValueBuckets> Buckets;
+	int32 NumIndexedResults{ 0 };
+};
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "OnlineSessionSettings.h"
+
+/*
+* A single attribute filter of a session search
+*/
+struct MULTIPLAYERSESSIONS_API FSessionSearchPredicate
+{
+	FName Key;
+	FVariantData Value;
+	EOnlineComparisonOp::Type ComparisonOp{ EOnlineComparisonOp::Equals };
+
+	bool operator==(const FSessionSearchPredicate& other) const
+	{
+		return Key == other.Key && Value == other.Value && ComparisonOp == other.ComparisonOp;
+	}
+};
+
+/*
+* Typed description of a session search
+* The match type and predicates are pushed into the QuerySettings of the search, so the backend filters before sending results
+* Backends that ignore query settings (LAN) get the same filter applied on the client once the search completes
+*/
+struct MULTIPLAYERSESSIONS_API FSessionSearchQuery
+{
+	int32 MaxSearchResults{ 10000 };
+	//Empty matches every match type
+	FString MatchType;
+	TArray<FSessionSearchPredicate> Predicates;
+	//Search dedicated servers instead of player hosted sessions, they advertise without presence
+	bool bDedicatedServers{ false };
+
+	template<typename ValueType>
+	FSessionSearchQuery& Where(FName key, const ValueType& value, EOnlineComparisonOp::Type comparisonOp = EOnlineComparisonOp::Equals)
+	{
+		FSessionSearchPredicate& predicate = Predicates.AddDefaulted_GetRef();
+		predicate.Key = key;
+		predicate.Value.SetValue(value);
+		predicate.ComparisonOp = comparisonOp;
+		return *this;
+	}
+
+	bool HasFilters() const { return bDedicatedServers || !MatchType.IsEmpty() || Predicates.Num() > 0; }
+
+	/*
+	* Fills in the search settings the backend gets
+	*/
+	void ApplyTo(FOnlineSessionSearch& sessionSearch) const;
+
+	/*
+	* Client side version of the filter
+	*/
+	bool Matches(const FOnlineSessionSearchResult& result) const;
+
+	/*
+	* True when the results of this query contain everything the other query would find
+	*/
+	bool Covers(const FSessionSearchQuery& other) const;
+
+	/*
+	* Evaluates the query settings of a search against a result, for backends that filter in process (mock, LAN)
+	* Engine search keys the result doesn't advertise (presence, lobbies, ...) are skipped
+	*/
+	static bool MatchesSearchSettings(const FOnlineSearchSettings& querySettings, const FOnlineSessionSearchResult& result);
+};
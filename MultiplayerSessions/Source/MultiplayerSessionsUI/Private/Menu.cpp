@@ -0,0 +1,283 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Menu.h"
+#include "Components/Button.h"
+#include "MultiplayerSessionsSubsystem.h"
+#include "OnlineSubsystem.h"
+#include "OnlineSessionSettings.h"
+#include "MultiplayerSessionsTrace.h"
+
+void UMenu::MenuSetup(int32 numOfPublicConnections, FString matchType, FString lobbyPath, bool bPrefetchSessions)
+{
+	NumPublicConnections = numOfPublicConnections;
+	MatchType = matchType;
+	LobbyPath = lobbyPath;
+	PathToLobby = FString::Printf(TEXT("%s?listen"), *lobbyPath);
+
+	AddToViewport();
+	SetVisibility(ESlateVisibility::Visible);
+	bIsFocusable = true;
+
+	UWorld* pWorld = GetWorld();
+	if (pWorld)
+	{
+		APlayerController* pController = pWorld->GetFirstPlayerController();
+		if (pController)
+		{
+			//Only have input on the UI widget
+			FInputModeUIOnly inputModeData;
+			inputModeData.SetWidgetToFocus(TakeWidget());
+			inputModeData.SetLockMouseToViewportBehavior(EMouseLockMode::DoNotLock);
+			pController->SetInputMode(inputModeData);
+			pController->SetShowMouseCursor(true);
+		}
+	}
+
+	UGameInstance* pGame = GetGameInstance();
+	if (pGame)
+	{
+		MultiplayerSessionsSubSystem = pGame->GetSubsystem<UMultiplayerSessionsSubsystem>();
+	}
+
+	if (MultiplayerSessionsSubSystem)
+	{
+		MultiplayerSessionsSubSystem->MultiplayerOnCreateSessionComplete.AddDynamic(this, &ThisClass::OnCreateSession);
+		MultiplayerSessionsSubSystem->MultiplayerOnFindSessionsPageComplete.AddUObject(this, &ThisClass::OnFindSessionsPage);
+		MultiplayerSessionsSubSystem->MultiplayerOnJoinSessionComplete.AddUObject(this, &ThisClass::OnJoinSessions);
+		MultiplayerSessionsSubSystem->MultiplayerOnDestroySessionComplete.AddDynamic(this, &ThisClass::OnDestroySession);
+		MultiplayerSessionsSubSystem->MultiplayerOnStartSessionComplete.AddDynamic(this, &ThisClass::OnStartSession);
+
+		//Start searching before the player clicks Join, so every page can be cut from the cached search
+		if (bPrefetchSessions)
+		{
+			MultiplayerSessionsSubSystem->StartSearchPrefetch(MakeJoinSearchQuery());
+		}
+	}
+}
+
+bool UMenu::Initialize()
+{
+	if (!Super::Initialize())
+	{
+		return false;
+	}
+
+	if (HostButton)
+	{
+		HostButton->OnClicked.AddDynamic(this, &ThisClass::HostButtonClicked);
+	}
+
+	if (JoinButton)
+	{
+		JoinButton->OnClicked.AddDynamic(this, &ThisClass::JoinButtonClicked);
+	}
+
+	return true;
+}
+
+void UMenu::NativeDestruct()
+{
+	MenuTearDown();
+	Super::NativeDestruct();
+}
+
+void UMenu::OnCreateSession(bool bWasSuccessful)
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(UMenu::OnCreateSession);
+
+	if (bWasSuccessful)
+	{
+		UWorld* pWorld = GetWorld();
+		if (pWorld)
+		{
+			if (MultiplayerSessionsSubSystem)
+			{
+				MultiplayerSessionsSubSystem->GetLatencyStats().BeginPhase(ESessionLatencyPhase::Travel);
+			}
+			pWorld->ServerTravel(PathToLobby);
+		}
+	}
+	else
+	{
+		//E.g. a match type that is not in the MatchTypeNames config, the log has the reason
+		if (GEngine)
+		{
+			GEngine->AddOnScreenDebugMessage(
+				-1,
+				15.0f,
+				FColor::Red,
+				FString::Printf(TEXT("Failed to create a %s session"), *MatchType)
+			);
+		}
+		HostButton->SetIsEnabled(true);
+	}
+}
+
+void UMenu::OnFindSessionsPage(const TArray<FOnlineSessionSearchResult>& pageResults, const FSessionSearchCursor& nextCursor, bool bWasSuccessful)
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(UMenu::OnFindSessionsPage);
+
+	if (!MultiplayerSessionsSubSystem)
+	{
+		return;
+	}
+
+	//The subsystem ranked the sessions of every page so far, the best one is first
+	//A ping the backend couldn't measure is left out, otherwise no session of such a backend would ever be good enough
+	const TArray<FRankedSession>& rankedSessions = MultiplayerSessionsSubSystem->GetRankedSessions();
+	const FOnlineSessionSearchResult* pBestSession = MultiplayerSessionsSubSystem->GetBestSession();
+	const bool bGoodSession = pBestSession && rankedSessions[0].Cost - MultiplayerSessionsSubSystem->GetSessionRanker().GetUnknownPingCost(*pBestSession) <= GoodSessionMaxCost;
+	const bool bMorePages = nextCursor.HasMorePages() && ++NumSearchPages < MaxSearchPages;
+
+	//Join the best one and fall back to the next ones
+	if (pBestSession && (bGoodSession || !bMorePages))
+	{
+		//The rest of the search would only hold up the join
+		if (nextCursor.HasMorePages())
+		{
+			MultiplayerSessionsSubSystem->CancelFindSessions();
+		}
+		MultiplayerSessionsSubSystem->JoinBestSession();
+		return;
+	}
+
+	if (bMorePages)
+	{
+		MultiplayerSessionsSubSystem->FindSessionsPage(MakeJoinSearchQuery(), SearchPageSize, nextCursor);
+		return;
+	}
+
+	JoinButton->SetIsEnabled(true);
+}
+
+void UMenu::OnJoinSessions(EOnJoinSessionCompleteResult::Type result)
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(UMenu::OnJoinSessions);
+
+	//Ask the subsystem for the address, it might be pointed at a different backend than the online subsystem
+	if (MultiplayerSessionsSubSystem && result == EOnJoinSessionCompleteResult::Success)
+	{
+		FSessionLatencyStats& latencyStats = MultiplayerSessionsSubSystem->GetLatencyStats();
+
+		FString address;
+		latencyStats.BeginPhase(ESessionLatencyPhase::ResolveConnectString);
+		const bool bResolved = MultiplayerSessionsSubSystem->GetResolvedConnectString(address);
+		latencyStats.EndPhase(ESessionLatencyPhase::ResolveConnectString);
+
+		if (bResolved)
+		{
+			APlayerController* pController = GetGameInstance()->GetFirstLocalPlayerController();
+			if (pController)
+			{
+				latencyStats.BeginPhase(ESessionLatencyPhase::Travel);
+				pController->ClientTravel(address, ETravelType::TRAVEL_Absolute);
+			}
+		}
+	}
+
+	if (result != EOnJoinSessionCompleteResult::Success)
+	{
+		JoinButton->SetIsEnabled(true);
+	}
+}
+
+void UMenu::OnDestroySession(bool bWasSuccessful)
+{
+}
+
+void UMenu::OnStartSession(bool bWasSuccessful)
+{
+	if (!GEngine)
+	{
+		return;
+	}
+
+	if (bWasSuccessful)
+	{
+		GEngine->AddOnScreenDebugMessage(
+			-1,
+			15.0f,
+			FColor::Green,
+			FString(TEXT("Session started"))
+		);
+	}
+	else
+	{
+		GEngine->AddOnScreenDebugMessage(
+			-1,
+			15.0f,
+			FColor::Red,
+			FString(TEXT("Session failed to start"))
+		);
+	}
+}
+
+void UMenu::HostButtonClicked()
+{
+	HostButton->SetIsEnabled(false);
+
+	if (MultiplayerSessionsSubSystem)
+	{
+		if (bPreloadLobbyMap)
+		{
+			MultiplayerSessionsSubSystem->PreloadMap(LobbyPath);
+		}
+		MultiplayerSessionsSubSystem->CreateSession(NumPublicConnections, MatchType);
+	}
+}
+
+void UMenu::JoinButtonClicked()
+{
+	JoinButton->SetIsEnabled(false);
+
+	if (MultiplayerSessionsSubSystem)
+	{
+		//The host decides the map, we assume it runs the same lobby as we would
+		if (bPreloadLobbyMap)
+		{
+			MultiplayerSessionsSubSystem->PreloadMap(LobbyPath);
+		}
+		//Only wait for more pages while none of them brought a good session, a prefetched search hands out its pages right away
+		NumSearchPages = 0;
+		MultiplayerSessionsSubSystem->FindSessionsPage(MakeJoinSearchQuery(), SearchPageSize);
+	}
+}
+
+FSessionSearchQuery UMenu::MakeJoinSearchQuery() const
+{
+	//Only sessions with our match type get sent back
+	FSessionSearchQuery query;
+	query.MaxSearchResults = SearchPageSize * MaxSearchPages;
+	query.MatchType = MatchType;
+	query.bDedicatedServers = bJoinDedicatedServers;
+	return query;
+}
+
+void UMenu::MenuTearDown()
+{
+	RemoveFromParent();
+
+	//The subsystem outlives the menu, don't leave callbacks to a destroyed widget behind
+	if (MultiplayerSessionsSubSystem)
+	{
+		MultiplayerSessionsSubSystem->StopSearchPrefetch();
+		MultiplayerSessionsSubSystem->MultiplayerOnCreateSessionComplete.RemoveAll(this);
+		MultiplayerSessionsSubSystem->MultiplayerOnFindSessionsPageComplete.RemoveAll(this);
+		MultiplayerSessionsSubSystem->MultiplayerOnJoinSessionComplete.RemoveAll(this);
+		MultiplayerSessionsSubSystem->MultiplayerOnDestroySessionComplete.RemoveAll(this);
+		MultiplayerSessionsSubSystem->MultiplayerOnStartSessionComplete.RemoveAll(this);
+	}
+
+	UWorld* pWorld = GetWorld();
+	if (pWorld)
+	{
+		APlayerController* pController = pWorld->GetFirstPlayerController();
+		if (pController)
+		{
+			FInputModeGameOnly inputModeData;
+			pController->SetInputMode(inputModeData);
+			pController->SetShowMouseCursor(false);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,17 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "MultiplayerSessionsUI.h"
+
+#define LOCTEXT_NAMESPACE "FMultiplayerSessionsUIModule"
+
+void FMultiplayerSessionsUIModule::StartupModule()
+{
+}
+
+void FMultiplayerSessionsUIModule::ShutdownModule()
+{
+}
+
+#undef LOCTEXT_NAMESPACE
+
+IMPLEMENT_MODULE(FMultiplayerSessionsUIModule, MultiplayerSessionsUI)
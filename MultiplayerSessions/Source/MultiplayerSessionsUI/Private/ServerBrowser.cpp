@@ -0,0 +1,455 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ServerBrowser.h"
+#include "ServerBrowserRow.h"
+#include "Components/Button.h"
+#include "Components/ListView.h"
+#include "Components/EditableTextBox.h"
+#include "MultiplayerSessionsSubsystem.h"
+#include "MultiplayerSessionsTrace.h"
+#include "SessionRanking.h"
+
+bool UServerBrowser::Initialize()
+{
+	if (!Super::Initialize())
+	{
+		return false;
+	}
+
+	if (RefreshButton)
+	{
+		RefreshButton->OnClicked.AddDynamic(this, &ThisClass::RefreshButtonClicked);
+	}
+
+	if (JoinButton)
+	{
+		JoinButton->OnClicked.AddDynamic(this, &ThisClass::JoinButtonClicked);
+	}
+
+	if (HostNameFilterText)
+	{
+		HostNameFilterText->OnTextChanged.AddDynamic(this, &ThisClass::HostNameFilterChanged);
+	}
+
+	if (SessionList)
+	{
+		SessionList->OnItemDoubleClicked().AddUObject(this, &ThisClass::SessionDoubleClicked);
+	}
+
+	return true;
+}
+
+void UServerBrowser::NativeConstruct()
+{
+	Super::NativeConstruct();
+
+	UGameInstance* pGame = GetGameInstance();
+	if (pGame)
+	{
+		MultiplayerSessionsSubSystem = pGame->GetSubsystem<UMultiplayerSessionsSubsystem>();
+	}
+
+	if (MultiplayerSessionsSubSystem)
+	{
+		MultiplayerSessionsSubSystem->MultiplayerOnFindSessionsComplete.AddUObject(this, &ThisClass::OnFindSessions);
+		MultiplayerSessionsSubSystem->MultiplayerOnFindSessionsBatch.AddUObject(this, &ThisClass::OnFindSessionsBatch);
+		MultiplayerSessionsSubSystem->MultiplayerOnJoinSessionComplete.AddUObject(this, &ThisClass::OnJoinSession);
+
+		//Show whatever the last search found, e.g. a prefetch, until the player refreshes
+		UpdateShownItems(true);
+	}
+}
+
+void UServerBrowser::NativeDestruct()
+{
+	//The subsystem outlives the browser, don't leave callbacks to a destroyed widget behind
+	if (MultiplayerSessionsSubSystem)
+	{
+		MultiplayerSessionsSubSystem->MultiplayerOnFindSessionsComplete.RemoveAll(this);
+		MultiplayerSessionsSubSystem->MultiplayerOnFindSessionsBatch.RemoveAll(this);
+		MultiplayerSessionsSubSystem->MultiplayerOnJoinSessionComplete.RemoveAll(this);
+	}
+
+	Super::NativeDestruct();
+}
+
+void UServerBrowser::Refresh()
+{
+	if (!MultiplayerSessionsSubSystem)
+	{
+		return;
+	}
+
+	if (RefreshButton)
+	{
+		RefreshButton->SetIsEnabled(false);
+	}
+
+	FSessionSearchQuery query;
+	query.MaxSearchResults = MaxSearchResults;
+	query.MatchType = MatchType;
+	query.bDedicatedServers = bDedicatedServers;
+
+	//Wait for every host instead of stopping early, the batches fill the list while the slow ones are still answering
+	MultiplayerSessionsSubSystem->FindSessionsStreaming(query, 0);
+}
+
+void UServerBrowser::SetSortMode(EServerBrowserSortMode sortMode)
+{
+	if (SortMode == sortMode)
+	{
+		return;
+	}
+
+	SortMode = sortMode;
+	if (MultiplayerSessionsSubSystem)
+	{
+		UpdateShownItems(false);
+	}
+}
+
+void UServerBrowser::SetHostNameFilter(const FString& hostNameFilter)
+{
+	if (HostNameFilter == hostNameFilter)
+	{
+		return;
+	}
+
+	HostNameFilter = hostNameFilter;
+	if (MultiplayerSessionsSubSystem)
+	{
+		UpdateShownItems(false);
+	}
+}
+
+void UServerBrowser::SetHideFullSessions(bool bHide)
+{
+	if (bHideFullSessions == bHide)
+	{
+		return;
+	}
+
+	bHideFullSessions = bHide;
+	if (MultiplayerSessionsSubSystem)
+	{
+		UpdateShownItems(false);
+	}
+}
+
+void UServerBrowser::JoinSelectedSession()
+{
+	if (!MultiplayerSessionsSubSystem || bJoining)
+	{
+		return;
+	}
+
+	//The item could still point into a search the subsystem already replaced
+	const UServerBrowserItem* pItem = SessionList->GetSelectedItem<UServerBrowserItem>();
+	const FSessionSearchIndex& searchIndex = MultiplayerSessionsSubSystem->GetSearchIndex();
+	if (!pItem || searchIndex.GetSessionSearch() != ShownSessionSearch.Pin() || pItem->ResultIndex < 0 || pItem->ResultIndex >= searchIndex.Num())
+	{
+		return;
+	}
+
+	bJoining = true;
+	if (JoinButton)
+	{
+		JoinButton->SetIsEnabled(false);
+	}
+	MultiplayerSessionsSubSystem->JoinsSession(searchIndex.GetResult(pItem->ResultIndex));
+}
+
+void UServerBrowser::OnFindSessions(const TArray<FOnlineSessionSearchResult>& sessionResults, bool bWasSuccessful)
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(UServerBrowser::OnFindSessions);
+
+	if (RefreshButton)
+	{
+		RefreshButton->SetIsEnabled(true);
+	}
+
+	//Results can be dropped or re-indexed when a search completes, every row reads its result again
+	UpdateShownItems(true);
+}
+
+void UServerBrowser::OnFindSessionsBatch(TArrayView<const FOnlineSessionSearchResult> batch)
+{
+	//Rows of the same search stay valid, only the first batch of a new search needs them rebound and everything filtered again
+	if (MultiplayerSessionsSubSystem->GetSearchIndex().GetSessionSearch() != ShownSessionSearch.Pin())
+	{
+		UpdateShownItems(true);
+	}
+	else
+	{
+		AddNewShownItems();
+	}
+}
+
+void UServerBrowser::OnJoinSession(EOnJoinSessionCompleteResult::Type result)
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(UServerBrowser::OnJoinSession);
+
+	if (!bJoining)
+	{
+		return;
+	}
+	bJoining = false;
+
+	//Ask the subsystem for the address, it might be pointed at a different backend than the online subsystem
+	if (MultiplayerSessionsSubSystem && result == EOnJoinSessionCompleteResult::Success)
+	{
+		FSessionLatencyStats& latencyStats = MultiplayerSessionsSubSystem->GetLatencyStats();
+
+		FString address;
+		latencyStats.BeginPhase(ESessionLatencyPhase::ResolveConnectString);
+		const bool bResolved = MultiplayerSessionsSubSystem->GetResolvedConnectString(address);
+		latencyStats.EndPhase(ESessionLatencyPhase::ResolveConnectString);
+
+		APlayerController* pController = GetGameInstance()->GetFirstLocalPlayerController();
+		if (bResolved && pController)
+		{
+			latencyStats.BeginPhase(ESessionLatencyPhase::Travel);
+			pController->ClientTravel(address, ETravelType::TRAVEL_Absolute);
+			return;
+		}
+	}
+
+	if (JoinButton)
+	{
+		JoinButton->SetIsEnabled(true);
+	}
+}
+
+void UServerBrowser::RefreshButtonClicked()
+{
+	Refresh();
+}
+
+void UServerBrowser::JoinButtonClicked()
+{
+	JoinSelectedSession();
+}
+
+void UServerBrowser::HostNameFilterChanged(const FText& text)
+{
+	SetHostNameFilter(text.ToString());
+}
+
+void UServerBrowser::SessionDoubleClicked(UObject* pItem)
+{
+	SessionList->SetSelectedItem(pItem);
+	JoinSelectedSession();
+}
+
+void UServerBrowser::UpdateShownItems(bool bRebindRows)
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(UServerBrowser::UpdateShownItems);
+
+	const FSessionSearchIndex& searchIndex = MultiplayerSessionsSubSystem->GetSearchIndex();
+	const TSharedPtr<FOnlineSessionSearch>& sessionSearch = searchIndex.GetSessionSearch();
+
+	ShownItems.Reset();
+	NumFilteredResults = 0;
+	if (sessionSearch.IsValid())
+	{
+		GrowItemPool();
+		UpdateRanks();
+
+		for (int32 resultIndex = 0; resultIndex < searchIndex.Num(); ++resultIndex)
+		{
+			if (PassesFilter(searchIndex.GetResult(resultIndex)))
+			{
+				ShownItems.Add(ItemPool[resultIndex]);
+			}
+		}
+		NumFilteredResults = searchIndex.Num();
+
+		ShownItems.Sort([this](const UServerBrowserItem& a, const UServerBrowserItem& b)
+		{
+			return IsShownBefore(a, b);
+		});
+	}
+	ShownSessionSearch = sessionSearch;
+
+	//The list view keeps the rows of items that are still on screen, only new items get a row bound
+	SessionList->SetListItems(ShownItems);
+	if (bRebindRows)
+	{
+		//Same items, but they point at different results now
+		SessionList->RegenerateAllEntries();
+	}
+}
+
+void UServerBrowser::AddNewShownItems()
+{
+	MULTIPLAYERSESSIONS_TRACE_SCOPE(UServerBrowser::AddNewShownItems);
+
+	const FSessionSearchIndex& searchIndex = MultiplayerSessionsSubSystem->GetSearchIndex();
+	if (searchIndex.Num() <= NumFilteredResults)
+	{
+		return;
+	}
+
+	GrowItemPool();
+	if (UpdateRanks())
+	{
+		//The shown items are not sorted by the new ranks, merging into them would keep them misordered
+		UpdateShownItems(false);
+		return;
+	}
+
+	TArray<UServerBrowserItem*> newItems;
+	newItems.Reserve(searchIndex.Num() - NumFilteredResults);
+	for (int32 resultIndex = NumFilteredResults; resultIndex < searchIndex.Num(); ++resultIndex)
+	{
+		if (PassesFilter(searchIndex.GetResult(resultIndex)))
+		{
+			newItems.Add(ItemPool[resultIndex]);
+		}
+	}
+	NumFilteredResults = searchIndex.Num();
+
+	if (newItems.Num() <= 0)
+	{
+		return;
+	}
+
+	//Only the batch gets sorted, the shown items already are
+	newItems.Sort([this](const UServerBrowserItem& a, const UServerBrowserItem& b)
+	{
+		return IsShownBefore(a, b);
+	});
+
+	//Merge from the back, so every shown item moves at most once and no second array is needed
+	int32 shownIndex = ShownItems.Num() - 1;
+	int32 newIndex = newItems.Num() - 1;
+	ShownItems.SetNum(ShownItems.Num() + newItems.Num());
+	for (int32 writeIndex = ShownItems.Num() - 1; newIndex >= 0; --writeIndex)
+	{
+		if (shownIndex >= 0 && IsShownBefore(*newItems[newIndex], *ShownItems[shownIndex]))
+		{
+			ShownItems[writeIndex] = ShownItems[shownIndex--];
+		}
+		else
+		{
+			ShownItems[writeIndex] = newItems[newIndex--];
+		}
+	}
+
+	SessionList->SetListItems(ShownItems);
+}
+
+void UServerBrowser::GrowItemPool()
+{
+	//Items are tiny and never change their index, so one per result is enough and it is only ever made once
+	const int32 numResults = MultiplayerSessionsSubSystem->GetSearchIndex().Num();
+	ItemPool.Reserve(numResults);
+	for (int32 resultIndex = ItemPool.Num(); resultIndex < numResults; ++resultIndex)
+	{
+		UServerBrowserItem* pItem = NewObject<UServerBrowserItem>(this);
+		pItem->ResultIndex = resultIndex;
+		ItemPool.Add(pItem);
+	}
+}
+
+bool UServerBrowser::UpdateRanks()
+{
+	//Only the best few are ranked, so this stays cheap even when it runs for every batch
+	TMap<int32, int32> rankByResultIndex;
+
+	//While a search streams in the ranks are still those of the previous one, their indices point at unrelated results
+	const TSharedPtr<FOnlineSessionSearch>& sessionSearch = MultiplayerSessionsSubSystem->GetSearchIndex().GetSessionSearch();
+	if (SortMode == EServerBrowserSortMode::Ranking && sessionSearch.IsValid() && MultiplayerSessionsSubSystem->GetRankedSessionSearch() == sessionSearch)
+	{
+		const TArray<FRankedSession>& rankedSessions = MultiplayerSessionsSubSystem->GetRankedSessions();
+		for (int32 rank = 0; rank < rankedSessions.Num(); ++rank)
+		{
+			rankByResultIndex.Add(rankedSessions[rank].ResultIndex, rank);
+		}
+	}
+
+	const bool bChanged = !RankByResultIndex.OrderIndependentCompareEqual(rankByResultIndex);
+	RankByResultIndex = MoveTemp(rankByResultIndex);
+	return bChanged;
+}
+
+bool UServerBrowser::IsShownBefore(const UServerBrowserItem& a, const UServerBrowserItem& b) const
+{
+	const FSessionSearchIndex& searchIndex = MultiplayerSessionsSubSystem->GetSearchIndex();
+	const FOnlineSessionSearchResult& resultA = searchIndex.GetResult(a.ResultIndex);
+	const FOnlineSessionSearchResult& resultB = searchIndex.GetResult(b.ResultIndex);
+
+	//Results the backend couldn't measure go last
+	auto getPing = [](const FOnlineSessionSearchResult& result)
+	{
+		return FSessionRanker::IsPingKnown(result.PingInMs) ? result.PingInMs : MAX_int32;
+	};
+
+	switch (SortMode)
+	{
+	case EServerBrowserSortMode::Ranking:
+	{
+		const int32* pRankA = RankByResultIndex.Find(a.ResultIndex);
+		const int32* pRankB = RankByResultIndex.Find(b.ResultIndex);
+		const int32 rankA = pRankA ? *pRankA : MAX_int32;
+		const int32 rankB = pRankB ? *pRankB : MAX_int32;
+		if (rankA != rankB)
+		{
+			return rankA < rankB;
+		}
+
+		const int32 pingA = getPing(resultA);
+		const int32 pingB = getPing(resultB);
+		if (pingA != pingB)
+		{
+			return pingA < pingB;
+		}
+		break;
+	}
+	case EServerBrowserSortMode::Ping:
+	{
+		const int32 pingA = getPing(resultA);
+		const int32 pingB = getPing(resultB);
+		if (pingA != pingB)
+		{
+			return pingA < pingB;
+		}
+		break;
+	}
+	case EServerBrowserSortMode::OpenSlots:
+	{
+		//Most room first
+		const int32 openSlotsA = resultA.Session.NumOpenPublicConnections;
+		const int32 openSlotsB = resultB.Session.NumOpenPublicConnections;
+		if (openSlotsA != openSlotsB)
+		{
+			return openSlotsA > openSlotsB;
+		}
+		break;
+	}
+	case EServerBrowserSortMode::HostName:
+	{
+		const int32 comparison = resultA.Session.OwningUserName.Compare(resultB.Session.OwningUserName, ESearchCase::IgnoreCase);
+		if (comparison != 0)
+		{
+			return comparison < 0;
+		}
+		break;
+	}
+	default:
+		break;
+	}
+
+	return a.ResultIndex < b.ResultIndex;
+}
+
+bool UServerBrowser::PassesFilter(const FOnlineSessionSearchResult& result) const
+{
+	if (bHideFullSessions && result.Session.NumOpenPublicConnections <= 0)
+	{
+		return false;
+	}
+
+	return HostNameFilter.IsEmpty() || result.Session.OwningUserName.Contains(HostNameFilter, ESearchCase::IgnoreCase);
+}
@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ServerBrowserRow.h"
+#include "Components/TextBlock.h"
+#include "MultiplayerSessionsSubsystem.h"
+#include "SessionAttributes.h"
+#include "SessionRanking.h"
+
+void UServerBrowserRow::NativeOnListItemObjectSet(UObject* listItemObject)
+{
+	IUserObjectListEntry::NativeOnListItemObjectSet(listItemObject);
+
+	UServerBrowserItem* pItem = Cast<UServerBrowserItem>(listItemObject);
+	UGameInstance* pGame = GetGameInstance();
+	UMultiplayerSessionsSubsystem* pSubsystem = pGame ? pGame->GetSubsystem<UMultiplayerSessionsSubsystem>() : nullptr;
+	if (!pItem || !pSubsystem)
+	{
+		return;
+	}
+
+	//The search might have been replaced since the browser handed out the item, the browser rebinds us once it sees the new one
+	const FSessionSearchIndex& searchIndex = pSubsystem->GetSearchIndex();
+	if (!searchIndex.GetSessionSearch().IsValid() || pItem->ResultIndex < 0 || pItem->ResultIndex >= searchIndex.Num())
+	{
+		return;
+	}
+
+	const FOnlineSessionSearchResult& result = searchIndex.GetResult(pItem->ResultIndex);
+	const FOnlineSessionSettings& settings = result.Session.SessionSettings;
+
+	HostNameText->SetText(FText::FromString(result.Session.OwningUserName));
+
+	const int32 numPlayers = settings.NumPublicConnections - result.Session.NumOpenPublicConnections;
+	PlayersText->SetText(FText::FromString(FString::Printf(TEXT("%d/%d"), numPlayers, settings.NumPublicConnections)));
+
+	PingText->SetText(FSessionRanker::IsPingKnown(result.PingInMs) ? FText::AsNumber(result.PingInMs) : FText::FromString(TEXT("?")));
+
+	if (MatchTypeText)
+	{
+		FSessionAttributes attributes;
+		const TCHAR* pMatchTypeName = FSessionAttributes::Read(settings, attributes) ? attributes.GetMatchTypeName() : nullptr;
+		MatchTypeText->SetText(FText::FromString(pMatchTypeName ? pMatchTypeName : TEXT("?")));
+	}
+}
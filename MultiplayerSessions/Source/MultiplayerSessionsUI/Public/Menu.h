@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Blueprint/UserWidget.h"
+#include "Interfaces/OnlineSessionInterface.h"
+#include "SessionSearchQuery.h"
+#include "Menu.generated.h"
+
+class UButton;
+class UMultiplayerSessionsSubsystem;
+struct FSessionSearchCursor;
+
+UCLASS()
+class MULTIPLAYERSESSIONSUI_API UMenu : public UUserWidget
+{
+	GENERATED_BODY()
+	
+public:
+	UFUNCTION(BlueprintCallable)
+	void MenuSetup(int32 numOfPublicConnections = 4, FString matchType = FString(TEXT("FreeForAll")), FString lobbyPath = FString(TEXT("/Game/ThirdPerson/Maps/Lobby")), bool bPrefetchSessions = false);
+
+protected:
+	virtual bool Initialize() override;
+	virtual void NativeDestruct() override;
+
+	/*
+	* Callbacks for custom delegates on the MultiplayerSessionsSubsystem
+	*/
+	UFUNCTION()
+	void OnCreateSession(bool bWasSuccessful);
+	void OnFindSessionsPage(const TArray<FOnlineSessionSearchResult>& pageResults, const FSessionSearchCursor& nextCursor, bool bWasSuccessful);
+	void OnJoinSessions(EOnJoinSessionCompleteResult::Type result);
+	UFUNCTION()
+	void OnDestroySession(bool bWasSuccessful);
+	UFUNCTION()
+	void OnStartSession(bool bWasSuccessful);
+
+private:
+	/*
+	* This UPROPERTY meta will link the button from the widget to this variable
+	* Variable needs the exact same name as the items in the widget blueprint!
+	*/
+	UPROPERTY(meta = (BindWidget))
+	UButton* HostButton;
+
+	UPROPERTY(meta = (BindWidget))
+	UButton* JoinButton;
+
+	UFUNCTION()
+	void HostButtonClicked();
+
+	UFUNCTION()
+	void JoinButtonClicked();
+
+	void MenuTearDown();
+	//Query the Join button pages through, its MaxSearchResults caps all pages together
+	FSessionSearchQuery MakeJoinSearchQuery() const;
+
+	/*
+	* Subsystem designed to handle all online session functionality
+	*/
+	UMultiplayerSessionsSubsystem* MultiplayerSessionsSubSystem;
+
+	//Join searches dedicated servers instead of sessions hosted by players
+	UPROPERTY(EditAnywhere, Category = "Sessions")
+	bool bJoinDedicatedServers{ false };
+
+	//Host and Join start loading the lobby map right away, so it loads while the session round trips are running
+	UPROPERTY(EditAnywhere, Category = "Sessions")
+	bool bPreloadLobbyMap{ false };
+
+	/*
+	* Join runs one search and looks at its sessions a page at a time, as they come in
+	* It joins at the first page that brings a good enough session and cancels the rest of the search
+	* When no page does, it joins the best one it saw after MaxSearchPages
+	*/
+	UPROPERTY(EditAnywhere, Category = "Sessions", meta = (ClampMin = "1"))
+	int32 SearchPageSize{ 50 };
+	UPROPERTY(EditAnywhere, Category = "Sessions", meta = (ClampMin = "1"))
+	int32 MaxSearchPages{ 20 };
+	//Highest ranking cost that counts as good enough, see FSessionRankingWeights
+	//Sessions whose ping nobody measured are judged without the UnknownPingInMs part of their cost
+	UPROPERTY(EditAnywhere, Category = "Sessions")
+	float GoodSessionMaxCost{ 100.0f };
+	int32 NumSearchPages{ 0 };
+
+	int32 NumPublicConnections{ 4 };
+	FString MatchType{ TEXT("FreeForAll") };
+	FString LobbyPath{ TEXT("") };
+	FString PathToLobby{ TEXT("") };
+};
@@ -0,0 +1,146 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Blueprint/UserWidget.h"
+#include "Interfaces/OnlineSessionInterface.h"
+#include "ServerBrowser.generated.h"
+
+class UButton;
+class UListView;
+class UEditableTextBox;
+class UServerBrowserItem;
+class UMultiplayerSessionsSubsystem;
+
+UENUM(BlueprintType)
+enum class EServerBrowserSortMode : uint8
+{
+	//Order the subsystem would join them in, the sessions it didn't rank follow by ping
+	Ranking,
+	Ping,
+	OpenSlots,
+	HostName
+};
+
+/*
+* Lists the sessions of the last search and joins the one the player picks
+* Built on a list view, so only the rows on screen exist as widgets, set its entry widget class to a UServerBrowserRow blueprint
+* Items are pooled and only hold an index into the search index of the subsystem, sorting and filtering reorder the items
+* without creating or rebinding rows that stay on screen
+*/
+UCLASS()
+class MULTIPLAYERSESSIONSUI_API UServerBrowser : public UUserWidget
+{
+	GENERATED_BODY()
+
+public:
+	//Starts a new search, rows show up as results stream in
+	UFUNCTION(BlueprintCallable)
+	void Refresh();
+
+	UFUNCTION(BlueprintCallable)
+	void SetSortMode(EServerBrowserSortMode sortMode);
+
+	//Only sessions whose host name contains the filter are shown, empty shows all
+	UFUNCTION(BlueprintCallable)
+	void SetHostNameFilter(const FString& hostNameFilter);
+
+	UFUNCTION(BlueprintCallable)
+	void SetHideFullSessions(bool bHide);
+
+	UFUNCTION(BlueprintCallable)
+	void JoinSelectedSession();
+
+	UFUNCTION(BlueprintPure)
+	int32 GetNumShownSessions() const { return ShownItems.Num(); }
+
+protected:
+	virtual bool Initialize() override;
+	virtual void NativeConstruct() override;
+	virtual void NativeDestruct() override;
+
+	/*
+	* Callbacks for custom delegates on the MultiplayerSessionsSubsystem
+	*/
+	void OnFindSessions(const TArray<FOnlineSessionSearchResult>& sessionResults, bool bWasSuccessful);
+	void OnFindSessionsBatch(TArrayView<const FOnlineSessionSearchResult> batch);
+	void OnJoinSession(EOnJoinSessionCompleteResult::Type result);
+
+private:
+	UPROPERTY(meta = (BindWidget))
+	UListView* SessionList;
+
+	UPROPERTY(meta = (BindWidgetOptional))
+	UButton* RefreshButton;
+
+	UPROPERTY(meta = (BindWidgetOptional))
+	UButton* JoinButton;
+
+	UPROPERTY(meta = (BindWidgetOptional))
+	UEditableTextBox* HostNameFilterText;
+
+	UFUNCTION()
+	void RefreshButtonClicked();
+
+	UFUNCTION()
+	void JoinButtonClicked();
+
+	UFUNCTION()
+	void HostNameFilterChanged(const FText& text);
+
+	void SessionDoubleClicked(UObject* pItem);
+
+	//Filters and sorts the indexed results into ShownItems, rows on screen only read their result again with bRebindRows
+	void UpdateShownItems(bool bRebindRows);
+	//Filters only the results indexed since the last update and merges them into the already sorted ShownItems
+	void AddNewShownItems();
+	void GrowItemPool();
+	//True when the ranks differ from the ones the shown items were sorted by
+	bool UpdateRanks();
+	//Order of the current sort mode, ties go by result index so every mode is a strict order
+	bool IsShownBefore(const UServerBrowserItem& a, const UServerBrowserItem& b) const;
+	bool PassesFilter(const FOnlineSessionSearchResult& result) const;
+
+	/*
+	* Subsystem designed to handle all online session functionality
+	*/
+	UMultiplayerSessionsSubsystem* MultiplayerSessionsSubSystem;
+
+	UPROPERTY(EditAnywhere, Category = "Sessions")
+	FString MatchType{ TEXT("FreeForAll") };
+
+	UPROPERTY(EditAnywhere, Category = "Sessions")
+	bool bDedicatedServers{ false };
+
+	UPROPERTY(EditAnywhere, Category = "Sessions", meta = (ClampMin = "1"))
+	int32 MaxSearchResults{ 10000 };
+
+	UPROPERTY(EditAnywhere, Category = "Sessions")
+	EServerBrowserSortMode SortMode{ EServerBrowserSortMode::Ranking };
+
+	UPROPERTY(EditAnywhere, Category = "Sessions")
+	bool bHideFullSessions{ false };
+
+	FString HostNameFilter;
+
+	//Item N always points at result N, kept across searches and only grown
+	UPROPERTY(Transient)
+	TArray<UServerBrowserItem*> ItemPool;
+
+	UPROPERTY(Transient)
+	TArray<UServerBrowserItem*> ShownItems;
+
+	//Search the rows were bound to, when the subsystem moves on to another one they need to read their result again
+	TWeakPtr<FOnlineSessionSearch> ShownSessionSearch;
+
+	//Results of ShownSessionSearch already run through the filter, batches only look at the ones past it
+	int32 NumFilteredResults{ 0 };
+
+	//Position of the ranked sessions by result index, looked up once per update instead of per comparison
+	//Empty until the shown search is ranked, the ranking sort orders by ping until then
+	TMap<int32, int32> RankByResultIndex;
+
+	//Only travel for joins we started
+	bool bJoining{ false };
+};
@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Blueprint/UserWidget.h"
+#include "Blueprint/IUserObjectListEntry.h"
+#include "ServerBrowserRow.generated.h"
+
+class UTextBlock;
+
+/*
+* List item of the server browser
+* Holds nothing but the index of a result in the search index of the MultiplayerSessionsSubsystem,
+* the browser pools them and the row reads the result only when it gets bound
+*/
+UCLASS()
+class MULTIPLAYERSESSIONSUI_API UServerBrowserItem : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	int32 ResultIndex{ INDEX_NONE };
+};
+
+/*
+* One row of the server browser
+* The list view only creates as many rows as fit on screen and rebinds them while scrolling
+*/
+UCLASS()
+class MULTIPLAYERSESSIONSUI_API UServerBrowserRow : public UUserWidget, public IUserObjectListEntry
+{
+	GENERATED_BODY()
+
+protected:
+	//IUserObjectListEntry
+	virtual void NativeOnListItemObjectSet(UObject* listItemObject) override;
+
+private:
+	/*
+	* Variables need the exact same name as the items in the widget blueprint!
+	*/
+	UPROPERTY(meta = (BindWidget))
+	UTextBlock* HostNameText;
+
+	UPROPERTY(meta = (BindWidget))
+	UTextBlock* PlayersText;
+
+	UPROPERTY(meta = (BindWidget))
+	UTextBlock* PingText;
+
+	UPROPERTY(meta = (BindWidgetOptional))
+	UTextBlock* MatchTypeText;
+};